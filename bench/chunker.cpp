@@ -0,0 +1,138 @@
+// -*- C++ -*-
+//===----------------------------- chunker.cpp ----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <unordered_set>
+#include "store.hpp"
+
+/**
+ *  Ingest benchmark of the dotfiles store on a synthetic history of config
+ *  files: every version edits a few lines of a tenth of the files and is
+ *  committed. Prints the ingest throughput and the storage ratio of the
+ *  chunked store, next to a store of whole files.
+ *
+ *      dotfiles-bench [files] [versions] [KiB per file]
+ */
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static double seconds(Clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+static std::string line(std::mt19937_64 & rng)
+{
+    static const char *keys[] = {"font", "color", "path", "alias", "bind",
+                                 "theme", "timeout", "editor", "shell", "opt"};
+    return std::string(keys[rng() % 10]) + "_" + std::to_string(rng() % 100000) +
+           " = " + std::to_string(rng()) + "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t files = argc > 1 ? std::stoul(argv[1]) : 200;
+    const std::size_t versions = argc > 2 ? std::stoul(argv[2]) : 20;
+    const std::size_t kib = argc > 3 ? std::stoul(argv[3]) : 64;
+
+    char dir[] = "/tmp/dotfiles-bench-XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    const fs::path home = fs::path(dir) / "home";
+    fs::create_directories(home / ".config");
+
+    std::mt19937_64 rng(42);
+    std::vector<std::vector<std::string>> content(files);
+    for (auto & lines : content)
+        for (std::size_t size = 0; size < kib * 1024;)
+            size += lines.emplace_back(line(rng)).size();
+
+    dotfiles::Store store(fs::path(dir) / "store", home);
+    dotfiles::Pool pool;
+    store.init();
+
+    uint64_t logical = 0, whole = 0, written = 0, ingested = 0;
+    std::unordered_set<std::string> unique;
+    Clock::duration spent{};
+
+    for (std::size_t v = 0; v < versions; v++)
+    {
+        // the first version writes every file, the next ones edit a tenth
+        std::vector<std::string> paths;
+        for (std::size_t f = 0; f < files; f++)
+        {
+            auto & lines = content[f];
+            if (v && rng() % 10) continue;
+            if (v)
+            {
+                for (int k = 0; k < 3; k++) lines[rng() % lines.size()] = line(rng);
+                lines.insert(lines.begin() + rng() % lines.size(), line(rng));
+                lines.erase(lines.begin() + rng() % lines.size());
+            }
+
+            const fs::path path = home / ".config" / ("file" + std::to_string(f));
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            for (auto & l : lines) out << l;
+            paths.push_back(path.string());
+        }
+
+        const Clock::time_point start = Clock::now();
+        dotfiles::Report added, report;
+        if (!v) added = store.add(paths, pool);
+        store.commit("version " + std::to_string(v), pool, report);
+        spent += Clock::now() - start;
+
+        ingested += added.bytes + report.bytes;
+        written += added.written + report.written;
+
+        for (auto & [path, entry] : store.load())
+        {
+            logical += entry.size;
+            if (unique.insert(entry.hash).second) whole += entry.size;
+        }
+    }
+
+    // the cpu side alone, chunking and hashing the last version in memory
+    std::string last;
+    for (auto & lines : content) for (auto & l : lines) last += l;
+    const Clock::time_point start = Clock::now();
+    std::size_t chunks = 0;
+    auto chunk = [&](std::size_t offset, std::size_t n) {
+        dotfiles::Sha256::of(last.data() + offset, n);
+        chunks++;
+    };
+    dotfiles::Chunker::split(last.data(), last.size(), chunk);
+    const double cpu = last.size() / 1048576.0 / seconds(Clock::now() - start);
+
+    std::cout << files << " files of " << kib << " KiB, " << versions
+              << " versions\n"
+              << "ingest      " << ingested / 1048576.0 / seconds(spent)
+              << " MB/s (" << ingested / 1048576.0 << " MB in "
+              << seconds(spent) << " s)\n"
+              << "in memory   " << cpu << " MB/s, " << last.size() / chunks
+              << " bytes per chunk\n"
+              << "history     " << logical / 1048576.0 << " MB\n"
+              << "whole files " << whole / 1048576.0 << " MB, ratio "
+              << double(logical) / whole << "\n"
+              << "chunked     " << written / 1048576.0 << " MB, ratio "
+              << double(logical) / written << "\n";
+
+    fs::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// -*- C++ -*-
+//===----------------------------- alloc.hpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_ALLOC_HPP
+#define CLI_ALLOC_HPP
+
+#include <cstdint>
+
+namespace cli
+{
+
+/**
+ * @brief Opt-in accounting of the heap allocations. The counting replacements
+ * of the global operator new and delete are in src/alloc.cpp, linked only into
+ * the binary that measures, built with CLI_COUNT_ALLOCATIONS defined. The
+ * counters are per thread, so a measured scope is not disturbed by other
+ * threads. Without alloc.cpp all the counters stay zero.
+ */
+namespace alloc
+{
+
+/**
+ * @brief Allocation counters of a thread, or the difference of two snapshots
+ *
+ */
+struct Counters
+{
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t bytes = 0;
+
+    Counters operator-(const Counters & c) const noexcept
+    {
+        return {allocations - c.allocations, deallocations - c.deallocations,
+                bytes - c.bytes};
+    }
+};
+
+/**
+ * @brief Counters of the calling thread, plain data so that updating them
+ * from operator new never allocates.
+ */
+inline thread_local Counters current;
+
+/**
+ * @brief whether the counting operators are compiled in
+ *
+ */
+constexpr bool enabled() noexcept
+{
+#ifdef CLI_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Snapshot of the counters of the calling thread
+ *
+ * @return Counters
+ */
+inline Counters counters() noexcept { return current; }
+
+/**
+ * @brief Measure the allocations made by the calling thread in a scope, for
+ * example to bound the allocations of a parse in a test.
+ *
+ *      cli::alloc::Scope scope;
+ *      program.parse(argc, argv);
+ *      assert(scope.count().allocations == 0);
+ */
+class Scope
+{
+    Counters start = current;
+
+public:
+    Counters count() const noexcept { return current - start; }
+};
+
+} // namespace alloc
+
+} // namespace cli
+
+#endif // CLI_ALLOC_HPP
@@ -0,0 +1,486 @@
+// -*- C++ -*-
+//===------------------------- basic_commander.hpp ------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_BASIC_COMMANDER_HPP
+#define CLI_BASIC_COMMANDER_HPP
+
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cli
+{
+
+/**
+ * @brief Error of the registration or of the parse of a BasicCommander, with
+ * the offending token, a view into the spec or into argv.
+ */
+struct ParseError
+{
+    enum Code : uint8_t
+    {
+        NONE,
+        INVALID_SYNTAX,
+        VARIADIC_NOT_LAST,
+        TOO_MANY_OPTIONS,
+        TOO_MANY_COMMANDS,
+        TOO_MANY_ARGS,
+        CMD_NOT_FOUND,
+        CMD_MISSING_ARG,
+        OPTION_NOT_FOUND,
+        ARG_MISSING
+    };
+
+    Code code = NONE;
+    std::string_view token;
+
+    explicit operator bool() const noexcept { return code != NONE; }
+
+    /**
+     * @brief what is the error all about
+     *
+     * @return const char*
+     */
+    const char * what() const noexcept;
+};
+
+/**
+ * @brief Commander of a fixed capacity that never allocates. The options, the
+ * commands and the values of a parse are held in std::arrays sized by the
+ * template arguments, and every name, spec and value is a view into the spec
+ * literals or into argv, so that nothing is allocated from the construction
+ * through parse(). Errors are returned instead of thrown, a registration
+ * beyond the capacity is kept and returned by parse().
+ *
+ * The specs and the descriptions are not copied, they must outlive the
+ * commander, string literals do.
+ *
+ * @tparam MaxOptions options that can be registered
+ * @tparam MaxCommands commands that can be registered
+ * @tparam MaxArgs values of args, of the command and the options, a parse
+ * can hold
+ */
+template <std::size_t MaxOptions, std::size_t MaxCommands, std::size_t MaxArgs>
+class BasicCommander
+{
+    /**
+     * @brief a registered option or command, name is the command or the flag,
+     * alias the second flag and args the args part of the spec
+     *
+     */
+    struct Spec
+    {
+        std::string_view spec, name, alias, args, description;
+    };
+
+    struct Value
+    {
+        std::string_view key, value;
+    };
+
+    std::string_view name, description;
+
+    std::array<Spec, MaxOptions> options{};
+    std::array<Spec, MaxCommands> commands{};
+    std::array<Value, MaxArgs> values{};
+    std::array<bool, MaxOptions> given{};
+    std::size_t noptions = 0, ncommands = 0, nvalues = 0;
+
+    const Spec *selected = nullptr;
+
+    /**
+     * @brief first error of the registration
+     *
+     */
+    ParseError invalid;
+
+    static bool is_flag(std::string_view arg) noexcept
+    {
+        return arg.size() && arg.front() == '-';
+    }
+
+    static std::string_view next(std::string_view & rest,
+                                 std::string_view separators) noexcept;
+    static bool arg(std::string_view token, std::string_view & key,
+                    bool & required, bool & variadic) noexcept;
+    static ParseError check(std::string_view args) noexcept;
+
+    ParseError bind(std::string_view args, char **first, char **last,
+                    std::string_view who, ParseError::Code missing) noexcept;
+    void fail(ParseError::Code code, std::string_view token) noexcept
+    {
+        if (!this->invalid) this->invalid = ParseError{code, token};
+    }
+
+public:
+    constexpr BasicCommander(std::string_view n,
+                             std::string_view d = "") noexcept
+        : name(n), description(d) {}
+
+    /**
+     * @brief Register an option, "-f, --flag <arg> [optional]"
+     *
+     * @param flag
+     * @param description
+     */
+    void option(std::string_view flag, std::string_view description = "") noexcept;
+
+    /**
+     * @brief Register a command, "name <arg> [optional] [rest...]"
+     *
+     * @param command
+     * @param description
+     */
+    void command(std::string_view command,
+                 std::string_view description = "") noexcept;
+
+    /**
+     * @brief Parse the input args, the values are views into argv
+     *
+     * @param argc
+     * @param argv
+     * @return ParseError, NONE on success
+     */
+    ParseError parse(int argc, char *argv[]) noexcept;
+
+    /**
+     * @brief Last value of the arg, "command" gives the command, empty if not
+     * given
+     *
+     * @param key
+     * @return std::string_view
+     */
+    std::string_view operator[](std::string_view key) const noexcept;
+
+    /**
+     * @brief Count of the values of the arg, of a variadic arg or a repeated
+     * option
+     *
+     * @param key
+     * @return std::size_t
+     */
+    std::size_t count(std::string_view key) const noexcept;
+
+    /**
+     * @brief Value of the arg at the index, among its values
+     *
+     * @param key
+     * @param idx
+     * @return std::string_view
+     */
+    std::string_view value(std::string_view key, std::size_t idx) const noexcept;
+
+    /**
+     * @brief Check if the option was given, by any of its flags
+     *
+     * @param flag
+     * @return true
+     * @return false
+     */
+    bool has(std::string_view flag) const noexcept;
+
+    /**
+     * @brief Write the usage through the function, called with string_views
+     *
+     * @param out
+     */
+    template <class Out> void usage(Out && out) const;
+};
+
+inline const char * ParseError::what() const noexcept
+{
+    switch (this->code)
+    {
+    case NONE:              return "";
+    case INVALID_SYNTAX:    return "Invalid Syntax for the spec ";
+    case VARIADIC_NOT_LAST: return "Only the last argument can be variadic ";
+    case TOO_MANY_OPTIONS:  return "Too many options, capacity exceeded by ";
+    case TOO_MANY_COMMANDS: return "Too many commands, capacity exceeded by ";
+    case TOO_MANY_ARGS:     return "Too many args, capacity exceeded by ";
+    case CMD_NOT_FOUND:     return "Command not found ";
+    case CMD_MISSING_ARG:   return "Missing command args ";
+    case OPTION_NOT_FOUND:  return "Unknown option ";
+    case ARG_MISSING:       return "argument required ";
+    }
+    return "";
+}
+
+/**
+ * @brief Take the next token of the rest, split by any of the separators
+ *
+ * @param rest
+ * @param separators
+ * @return std::string_view empty at the end
+ */
+template <std::size_t O, std::size_t C, std::size_t A>
+std::string_view BasicCommander<O, C, A>::next(std::string_view & rest,
+                                               std::string_view separators) noexcept
+{
+    const std::size_t first = rest.find_first_not_of(separators);
+    if (first == std::string_view::npos) return rest = std::string_view();
+
+    const std::size_t last = std::min(rest.find_first_of(separators, first),
+                                      rest.size());
+    std::string_view token = rest.substr(first, last - first);
+    rest.remove_prefix(last);
+    return token;
+}
+
+/**
+ * @brief Read an arg of a spec, "<name>", "[name]" or with a "..." suffix
+ *
+ * @param token
+ * @param key
+ * @param required
+ * @param variadic
+ * @return false if the arg is invalid
+ */
+template <std::size_t O, std::size_t C, std::size_t A>
+bool BasicCommander<O, C, A>::arg(std::string_view token, std::string_view & key,
+                                  bool & required, bool & variadic) noexcept
+{
+    if (token.size() < 3) return false;
+    required = token.front() == '<';
+    if (!(required && token.back() == '>') &&
+        !(token.front() == '[' && token.back() == ']'))
+        return false;
+
+    key = token.substr(1, token.size() - 2);
+    variadic = key.size() > 3 && key.substr(key.size() - 3) == "...";
+    if (variadic) key.remove_suffix(3);
+    return true;
+}
+
+/**
+ * @brief Check the args part of a spec
+ *
+ * @param args
+ * @return ParseError
+ */
+template <std::size_t O, std::size_t C, std::size_t A>
+ParseError BasicCommander<O, C, A>::check(std::string_view args) noexcept
+{
+    std::string_view key;
+    bool required = false, variadic = false, last = false;
+    for (std::string_view token = next(args, " \t"); token.size();
+         token = next(args, " \t"))
+    {
+        if (last) return ParseError{ParseError::VARIADIC_NOT_LAST, token};
+        if (!arg(token, key, required, variadic))
+            return ParseError{ParseError::INVALID_SYNTAX, token};
+        last = variadic;
+    }
+    return ParseError{};
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+void BasicCommander<O, C, A>::option(std::string_view flag,
+                                     std::string_view description) noexcept
+{
+    Spec spec{flag, {}, {}, {}, description};
+    std::string_view rest = flag;
+
+    spec.name = next(rest, " \t,|");
+    if (!is_flag(spec.name)) return this->fail(ParseError::INVALID_SYNTAX, flag);
+
+    // an optional second flag, a third one is an error
+    std::string_view after = rest, token = next(rest, " \t,|");
+    if (is_flag(token)) after = rest, spec.alias = token;
+    if (is_flag(next(rest, " \t,|")) && spec.alias.size())
+        return this->fail(ParseError::INVALID_SYNTAX, flag);
+
+    spec.args = after;
+    if (ParseError e = check(spec.args)) return this->fail(e.code, e.token);
+    if (this->noptions == O) return this->fail(ParseError::TOO_MANY_OPTIONS, flag);
+
+    this->options[this->noptions++] = spec;
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+void BasicCommander<O, C, A>::command(std::string_view command,
+                                      std::string_view description) noexcept
+{
+    Spec spec{command, {}, {}, {}, description};
+    std::string_view rest = command;
+
+    spec.name = next(rest, " \t");
+    if (spec.name.empty() || is_flag(spec.name))
+        return this->fail(ParseError::INVALID_SYNTAX, command);
+
+    spec.args = rest;
+    if (ParseError e = check(spec.args)) return this->fail(e.code, e.token);
+    if (this->ncommands == C)
+        return this->fail(ParseError::TOO_MANY_COMMANDS, command);
+
+    this->commands[this->ncommands++] = spec;
+}
+
+/**
+ * @brief Bind the given args to the args of the spec, a variadic arg takes
+ * all the remaining ones, and args beyond the spec are ignored
+ *
+ * @param args
+ * @param first
+ * @param last
+ * @param who the command or the flag, for the errors
+ * @param missing the error of a missing required arg
+ * @return ParseError
+ */
+template <std::size_t O, std::size_t C, std::size_t A>
+ParseError BasicCommander<O, C, A>::bind(std::string_view args, char **first,
+                                         char **last, std::string_view who,
+                                         ParseError::Code missing) noexcept
+{
+    std::string_view key;
+    bool required = false, variadic = false;
+    for (std::string_view token = next(args, " \t"); token.size();
+         token = next(args, " \t"))
+    {
+        arg(token, key, required, variadic);
+        if (first == last)
+        {
+            if (required) return ParseError{missing, who};
+            break;
+        }
+
+        for (char **end = variadic ? last : first + 1; first != end; first++)
+        {
+            if (this->nvalues == A)
+                return ParseError{ParseError::TOO_MANY_ARGS, *first};
+            this->values[this->nvalues++] = Value{key, *first};
+        }
+    }
+    return ParseError{};
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+ParseError BasicCommander<O, C, A>::parse(int argc, char *argv[]) noexcept
+{
+    this->nvalues = 0, this->selected = nullptr;
+    this->given.fill(false);
+    if (this->invalid) return this->invalid;
+
+    int i = 1;
+    auto args_end = [&](int from) {
+        while (from < argc && !is_flag(argv[from])) from++;
+        return from;
+    };
+
+    // the command and its args, up to the first flag
+    if (i < argc && argv[i][0] && !is_flag(argv[i]))
+    {
+        const std::string_view cmd = argv[i++];
+        for (std::size_t c = 0; c < this->ncommands; c++)
+            if (this->commands[c].name == cmd) this->selected = &this->commands[c];
+        if (!this->selected) return ParseError{ParseError::CMD_NOT_FOUND, cmd};
+
+        const int end = args_end(i);
+        if (ParseError e = this->bind(this->selected->args, argv + i, argv + end,
+                                      cmd, ParseError::CMD_MISSING_ARG))
+            return e;
+        i = end;
+    }
+
+    // the options, each one followed by its args
+    for (; i < argc; i++)
+    {
+        const std::string_view flag = argv[i];
+        if (!is_flag(flag)) continue;
+
+        std::size_t o = 0;
+        while (o < this->noptions && this->options[o].name != flag &&
+               this->options[o].alias != flag)
+            o++;
+        if (o == this->noptions)
+            return ParseError{ParseError::OPTION_NOT_FOUND, flag};
+        this->given[o] = true;
+
+        const int end = args_end(i + 1);
+        if (ParseError e = this->bind(this->options[o].args, argv + i + 1,
+                                      argv + end, flag, ParseError::ARG_MISSING))
+            return e;
+        i = end - 1;
+    }
+    return ParseError{};
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+std::string_view BasicCommander<O, C, A>::operator[](std::string_view key) const noexcept
+{
+    if (key == "command")
+        return this->selected ? this->selected->name : std::string_view();
+
+    for (std::size_t i = this->nvalues; i--;)
+        if (this->values[i].key == key) return this->values[i].value;
+    return std::string_view();
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+std::size_t BasicCommander<O, C, A>::count(std::string_view key) const noexcept
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < this->nvalues; i++)
+        n += this->values[i].key == key;
+    return n;
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+std::string_view BasicCommander<O, C, A>::value(std::string_view key,
+                                                std::size_t idx) const noexcept
+{
+    for (std::size_t i = 0; i < this->nvalues; i++)
+        if (this->values[i].key == key && !idx--) return this->values[i].value;
+    return std::string_view();
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+bool BasicCommander<O, C, A>::has(std::string_view flag) const noexcept
+{
+    for (std::size_t o = 0; o < this->noptions; o++)
+        if (this->options[o].name == flag || this->options[o].alias == flag)
+            return this->given[o];
+    return false;
+}
+
+template <std::size_t O, std::size_t C, std::size_t A>
+template <class Out>
+void BasicCommander<O, C, A>::usage(Out && out) const
+{
+    static constexpr std::string_view pad = "                                ";
+    std::size_t width = 0;
+    for (std::size_t c = 0; c < this->ncommands; c++)
+        width = std::max(width, this->commands[c].spec.size());
+    for (std::size_t o = 0; o < this->noptions; o++)
+        width = std::max(width, this->options[o].spec.size());
+    width = std::min(width + 4, pad.size());
+
+    auto row = [&](const Spec & s) {
+        out(std::string_view("    ")), out(s.spec);
+        out(pad.substr(0, width > s.spec.size() ? width - s.spec.size() : 1));
+        out(s.description), out(std::string_view("\n"));
+    };
+
+    out(std::string_view("Usage: ")), out(this->name);
+    out(std::string_view(" <command> [options]\n"));
+    if (this->description.size()) out(this->description), out(std::string_view("\n"));
+
+    if (this->ncommands) out(std::string_view("\nCommands:\n"));
+    for (std::size_t c = 0; c < this->ncommands; c++) row(this->commands[c]);
+
+    if (this->noptions) out(std::string_view("\nOptions:\n"));
+    for (std::size_t o = 0; o < this->noptions; o++) row(this->options[o]);
+}
+
+} // namespace cli
+
+#endif // CLI_BASIC_COMMANDER_HPP
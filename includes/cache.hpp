@@ -0,0 +1,284 @@
+// -*- C++ -*-
+//===----------------------------- cache.hpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_CACHE_HPP
+#define CLI_CACHE_HPP
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <alloc.hpp>
+#include <values.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief Properties produced by a parse, readable through Commander's []
+ */
+using Properties = std::map<std::string, std::string, std::less<>>;
+
+/**
+ * @brief All the values of the args, by the name of the arg
+ */
+using Lists = std::map<std::string, Values, std::less<>>;
+
+/**
+ * @brief Everything produced by a parse, the properties hold a single value of
+ * each arg (the first value of a command's arg, the last of an option's) and 
+ * the lists hold all of them.
+ */
+struct Parsed
+{
+    Properties properties;
+    Lists lists;
+};
+
+/**
+ * @brief Shared immutable result of a parse, can be held after the commander
+ * has moved on to parse another command line.
+ */
+using Result = std::shared_ptr<const Parsed>;
+
+/**
+ * @brief Counters reported by Commander::stats()
+ *
+ */
+struct Stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+
+    /**
+     * @brief heap allocations made by the last parse, counted only if the lib
+     * -rary is built with CLI_COUNT_ALLOCATIONS.
+     */
+    alloc::Counters parse;
+};
+
+/**
+ * @brief Bounded LRU cache of parse results keyed by the content of argv. The
+ * capacity is given in bytes and is checked against an estimate of the memory
+ * held by each entry. All the members are safe to call from multiple threads.
+ *
+ * A cache must only be shared by commanders with the same options and comma
+ * -nds, since the spec is not part of the key.
+ */
+class Cache
+{
+    struct Entry
+    {
+        uint64_t hash;
+        std::string key;
+        Result result;
+        std::size_t bytes;
+    };
+
+    /**
+     * @brief maximum bytes held by all the entries together
+     *
+     */
+    std::size_t capacity;
+
+    /**
+     * @brief bytes currently held by the entries
+     *
+     */
+    std::size_t used = 0;
+
+    /**
+     * @brief entries in the order of use, most recent at the front
+     *
+     */
+    std::list<Entry> lru;
+
+    /**
+     * @brief index from the hash of the argv to its entry in the lru list
+     *
+     */
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    mutable std::mutex mutex;
+    std::atomic<uint64_t> hit_count{0}, miss_count{0}, eviction_count{0};
+
+    static uint64_t hash(int argc, char *argv[]) noexcept;
+    static bool same(const std::string & key, int argc, char *argv[]) noexcept;
+    static std::size_t footprint(const std::string & key, const Parsed & p);
+
+public:
+    explicit Cache(std::size_t bytes) : capacity(bytes) {}
+
+    /**
+     * @brief Lookup the result of a previous parse of the same args, returns
+     * an empty result on miss.
+     *
+     * @param argc
+     * @param argv
+     * @return Result
+     */
+    Result find(int argc, char *argv[]);
+
+    /**
+     * @brief Insert the result for the args, evicting the least recently used
+     * entries until the cache fits in its capacity.
+     *
+     * @param argc
+     * @param argv
+     * @param result
+     */
+    void insert(int argc, char *argv[], Result result);
+
+    /**
+     * @brief Snapshot of the cache counters
+     *
+     * @return Stats
+     */
+    Stats stats() const;
+};
+
+/**
+ * @brief FNV-1a over the args, each arg is terminated by its '\0' so that the
+ * split between args is part of the hash.
+ *
+ * @param argc
+ * @param argv
+ * @return uint64_t
+ */
+uint64_t Cache::hash(int argc, char *argv[]) noexcept
+{
+    uint64_t h = 14695981039346656037ull;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *c = argv[i];
+        do h = (h ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+        while (*c++);
+    }
+    return h;
+}
+
+/**
+ * @brief Compare a stored key with the args without building a new string
+ *
+ * @param key
+ * @param argc
+ * @param argv
+ * @return true
+ * @return false
+ */
+bool Cache::same(const std::string & key, int argc, char *argv[]) noexcept
+{
+    std::size_t pos = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::size_t len = std::strlen(argv[i]) + 1;
+        if (pos + len > key.size() || 
+            std::memcmp(key.data() + pos, argv[i], len)) return false;
+        pos += len;
+    }
+    return pos == key.size();
+}
+
+/**
+ * @brief Estimate the memory held by an entry, including the map nodes
+ *
+ * @param key
+ * @param p
+ * @return std::size_t
+ */
+std::size_t Cache::footprint(const std::string & key, const Parsed & p)
+{
+    // list node, index node and the control block of the shared result
+    std::size_t bytes = sizeof(Entry) + 96 + sizeof(Parsed) + key.capacity();
+    for (auto & el : p.properties)
+        bytes += 64 + el.first.capacity() + el.second.capacity();
+    for (auto & el : p.lists)
+        bytes += 64 + el.first.capacity() + el.second.capacity();
+    return bytes;
+}
+
+Result Cache::find(int argc, char *argv[])
+{
+    const uint64_t h = hash(argc, argv);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto itr = this->index.find(h);
+    if (itr == this->index.end() || !same(itr->second->key, argc, argv))
+    {
+        this->miss_count++;
+        return nullptr;
+    }
+
+    // move the entry to the front of the lru list
+    this->lru.splice(this->lru.begin(), this->lru, itr->second);
+    this->hit_count++;
+    return itr->second->result;
+}
+
+void Cache::insert(int argc, char *argv[], Result result)
+{
+    std::string key;
+    for (int i = 1; i < argc; i++) 
+        key.append(argv[i], std::strlen(argv[i]) + 1);
+
+    const uint64_t h = hash(argc, argv);
+    const std::size_t bytes = footprint(key, *result);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (bytes > this->capacity) return;
+
+    // a different args with the same hash, or a concurrent insert of the same
+    // args, replaces the entry in place
+    auto itr = this->index.find(h);
+    if (itr != this->index.end())
+    {
+        this->used -= itr->second->bytes;
+        this->lru.erase(itr->second);
+        this->index.erase(itr);
+    }
+
+    while (this->used + bytes > this->capacity && this->lru.size())
+    {
+        this->used -= this->lru.back().bytes;
+        this->index.erase(this->lru.back().hash);
+        this->lru.pop_back();
+        this->eviction_count++;
+    }
+
+    this->lru.push_front({h, std::move(key), std::move(result), bytes});
+    this->index.insert({h, this->lru.begin()});
+    this->used += bytes;
+}
+
+Stats Cache::stats() const
+{
+    Stats s;
+    s.hits = this->hit_count;
+    s.misses = this->miss_count;
+    s.evictions = this->eviction_count;
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    s.entries = this->lru.size();
+    s.bytes = this->used;
+    return s;
+}
+
+} // namespace cli
+
+#endif // CLI_CACHE_HPP
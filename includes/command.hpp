@@ -19,6 +19,7 @@
 #include <colors.hpp>
 #include <helper.hpp>
 #include <exception.hpp>
+#include <text.hpp>
 
 namespace cli
 {
@@ -44,14 +45,32 @@ class Command
      */
     std::vector<std::string> argv; 
 
+    /**
+     * @brief whether the last arg is variadic ('<paths...>'), taking all the 
+     * remaining args.
+     * 
+     */
+    bool variadic = false;
+
     /**
      * @brief 
      * 
      */
-    std::string description;
+    Text description;
 
 public:
-    Command(const std::string command, const std::string description = "");
+    explicit Command(const std::string command, 
+                     const Text description = Text());
+
+    /**
+     * @brief Bind a cold description to the help catalog
+     * 
+     * @param catalog 
+     */
+    void bind(const std::shared_ptr<const Catalog> & catalog)
+    {
+        this->description.bind(catalog);
+    }
 
     void handleArg(std::string str);
     int getRequired() const noexcept
@@ -59,14 +78,49 @@ public:
         return this->required;
     }
 
-    std::vector<std::string> getargv() const noexcept
+    const std::vector<std::string> & getargv() const noexcept
     {
         return this->argv;
     }
 
+    bool isVariadic() const noexcept
+    {
+        return this->variadic;
+    }
+
+    const std::string & getName() const noexcept
+    {
+        return this->command;
+    }
+
+    /**
+     * @brief Nest the command under its parent, the scope is the name of the 
+     * parent followed by a space.
+     * 
+     * @param scope 
+     */
+    void nest(const std::string & scope)
+    {
+        this->command.insert(0, scope);
+    }
+
     bool validate(int size) const;
 
     bool operator<(const Command & command) const;
+
+    /**
+     * @brief Compare with a command name, lets the commands be looked up by 
+     * name without building a Command.
+     */
+    friend bool operator<(const Command & c, std::string_view name) noexcept
+    {
+        return c.command < name;
+    }
+
+    friend bool operator<(std::string_view name, const Command & c) noexcept
+    {
+        return name < c.command;
+    }
     friend std::ostream& operator<<(std::ostream & os, const Command & command);
 };
 
@@ -76,7 +130,7 @@ public:
  * @param command 
  * @param description 
  */
-Command::Command(const std::string command, const std::string description) 
+Command::Command(const std::string command, const Text description) 
 {
     // process the command. If the command has args, the resolve the required count 
     // depending on <> and []
@@ -84,7 +138,7 @@ Command::Command(const std::string command, const std::string description)
 
     this->description = description;
     this->command = tokenized[0];
-    for (int i = 1; i < tokenized.size(); i++) {
+    for (std::size_t i = 1; i < tokenized.size(); i++) {
         this->handleArg(tokenized[i]);
     }
 }
@@ -97,9 +151,11 @@ Command::Command(const std::string command, const std::string description)
 void Command::handleArg(std::string str)
 {
     if (str.front() == '<') required++;
+    if (this->variadic) throw Exception(errstr::option::VARIADIC_NOT_LAST);
 
     str.pop_back();
     str.erase(0, 1);
+    this->variadic = helper::variadic(str);
     this->argv.push_back(str);
 }
 
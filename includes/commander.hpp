@@ -13,31 +13,106 @@
 #define CLI_COMMANDER_HPP
 
 #include <iostream>
+#include <cstring>
 #include <string>
 #include <regex>
 #include <iomanip>
 #include <map>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <alloc.hpp>
+#include <cache.hpp>
 #include <command.hpp>
 #include <exception.hpp>
 #include <helper.hpp>
 #include <option.hpp>
+#include <plugin.hpp>
+#include <stream.hpp>
+#include <validator.hpp>
+#include <text.hpp>
 #include <colors.hpp>
 
 namespace cli
 {
+
+class Commander;
+
+/**
+ * @brief Builder of a lazily registered command, defines the command's options
+ * and subcommands on the commander when the command is selected.
+ */
+using Builder = std::function<void(Commander &)>;
     
 class Commander
 {
+    // interactive sessions read the spec to parse incrementally
+    friend class Session;
+
     // Name and description for the program 
-    std::string name, description;
+    std::string name;
+    Text description;
+
+    /**
+     * @brief help texts kept out of the spec, cold descriptions of options and
+     * commands are resolved from it only when the usage is rendered.
+     */
+    std::shared_ptr<Catalog> help_catalog = std::make_shared<Catalog>();
 
     /**
      * @brief This stores all the properties, which are accessable by externel 
      * user tho this is not directly visible to user, but can be read using 
      * over- loaded [] operator for this class.
      */
-    std::map<std::string, std::string> properties;
+    Properties properties;
+
+    /**
+     * @brief all the values of the args, for repeated options and variadic
+     * args, published with the properties.
+     */
+    Lists lists;
+
+    /**
+     * @brief the properties published by the last parse, shared with the cache
+     * and with the callers of result().
+     */
+    Result parsed;
+
+    /**
+     * @brief what a parse leaves for the next one: the nodes of its properties
+     * and of its lists, and the result it published once nobody else holds it,
+     * so that parsing the same shape of command line again allocates nothing.
+     */
+    std::vector<Properties::node_type> spare_properties;
+    std::vector<Lists::node_type> spare_lists;
+    std::shared_ptr<Parsed> published;
+
+    /**
+     * @brief optional cache of parse results, keyed by the runtime args
+     */
+    std::shared_ptr<Cache> results;
+
+    /**
+     * @brief index of the external <name>-<command> executables, set only if 
+     * the external dispatch is enabled.
+     */
+    std::unique_ptr<Plugins> plugins;
+
+    /**
+     * @brief validators of the args by their names, run on every value in the
+     * parse.
+     */
+    std::map<std::string, Validator, std::less<>> validators;
+
+    /**
+     * @brief the command selected by the last parse, null if none
+     */
+    const Command *selected = nullptr;
+
+    /**
+     * @brief heap allocations made by the last parse
+     */
+    alloc::Counters parse_allocations;
 
     /**
      * @brief this store all the user defined options and their values for the 
@@ -46,34 +121,102 @@ class Commander
      */
     std::vector<Option> options;
 
+    /**
+     * @brief options registered by the builder of a lazy command, by the full
+     * name of the command. They are accepted only for the command and its sub
+     * -commands, and listed apart in the usage.
+     */
+    std::map<std::string, std::vector<Option>, std::less<>> scoped;
+
     /**
      * @brief this stores the list of all the user's commands for the program,
      * these values are updated when the parse method is called. 
      */
-    std::map<Command, std::string> commands;
+    using Commands = std::map<Command, std::string, std::less<>>;
+    Commands commands;
+
+    /**
+     * @brief commands registered with a builder, kept as their raw spec until
+     * selected by the parse or enumerated by the usage. Keyed by full name.
+     */
+    struct Lazy
+    {
+        std::string spec;
+        Text description;
+        Builder builder;
+    };
+    std::map<std::string, Lazy, std::less<>> lazy;
+
+    /**
+     * @brief name of the command whose builder is running followed by a space,
+     * the commands it registers are nested under it.
+     */
+    std::string scope;
 
     /**
      * @brief this stores the args at the provided at run time, updated by the
      * parse method.
      */
-    std::vector<std::string> option_args;
+    std::vector<std::string_view> option_args;
 
     /**
      * @brief this is to store commands args provided at the runtime, updated 
      * by the parser 
      */
-    std::vector<std::string> command_args;
+    std::vector<std::string_view> command_args;
+
+    /**
+     * @brief args of the option being parsed, kept for its buffer
+     */
+    std::vector<std::string_view> option_values;
+
+    /**
+     * @brief set by stream(), the args of the command are then left in argv,
+     * between stream_first and stream_last, to be pulled by positionals().
+     */
+    bool streaming = false;
+    char **stream_first = nullptr, **stream_last = nullptr;
+
+    /**
+     * @brief whether the usage and the version exit the process once printed,
+     * interactive sessions clear it to keep running.
+     */
+    bool exits = true;
 
     // Helper functions 
+    void run(int argc, char *argv[]);
+    void reset();
     void populate(int arc, char *argv[]);
     void parse_cmd();
     void parse_options();
-    void is_cmd_version();
-    void is_cmd_help();
+    bool is_cmd_version();
+    bool is_cmd_help();
+    std::string suggest_cmd(const std::string & cmd) const;
+    Commands::const_iterator find_cmd(std::string_view name);
+    bool has_subcommands(const std::string & cmd) const;
+    void materialize();
+    void select(std::string_view name);
+    bool dispatch(const std::string & cmd);
+    std::vector<std::string> external_names() const;
+    void fallback(std::shared_ptr<Default> value);
+    void store(const std::string & key, 
+               std::vector<std::string_view>::const_iterator first,
+               std::vector<std::string_view>::const_iterator last);
+    std::string suggest_option(std::string_view flag, const Command *cmd) const;
+    std::vector<Option> & registry();
+    Option * find_option(std::string_view flag, const Command *cmd);
+    template <class Fn> void each_option(const Command *cmd, Fn && fn) const;
+    template <class Map> 
+    typename Map::mapped_type & entry(Map & map, 
+                                      std::vector<typename Map::node_type> & spare,
+                                      std::string_view key);
 
 public:
     Commander(const std::string & n, 
-              const std::string & d = "") : name(n),description(d) {}
+              const Text & d = Text()) : name(n),description(d) 
+    {
+        this->description.bind(this->help_catalog);
+    }
 
     //===-----------------------------------------------------------------===//
     //                                                                       //
@@ -90,7 +233,7 @@ public:
      */
     void version(const std::string & version, 
                  const std::string & flag = df::version_flag, 
-                 const std::string & description = df::version_description);
+                 const Text & description = df::version_description);
 
     /**
      * @brief Register a help option to the program
@@ -99,7 +242,7 @@ public:
      * @param description 
      */
     void help(const std::string & flag = df::help_flag, 
-              const std::string & description = df::help_description);
+              const Text & description = df::help_description);
 
     /**
      * @brief Register a new option to the program 
@@ -108,7 +251,34 @@ public:
      * @param description 
      */
     void option(const std::string & flag, 
-                const std::string & description = "");
+                const Text & description = Text());
+
+    /**
+     * @brief Register a new option with a default value for its argument, read
+     * by [] when the option is not given.
+     * 
+     * @param flag 
+     * @param description 
+     * @param value 
+     */
+    void option(const std::string & flag, const Text & description, 
+                const std::string & value);
+
+    /**
+     * @brief Register a new option with a lazily computed default value. The
+     * callable runs only when the option is absent and its argument is read, 
+     * once, the value is kept for the later reads. 
+     * 
+     *      program.option("-r, --root <dir>", "repository root", [] {
+     *          return probe_repository_root();
+     *      });
+     * 
+     * @param flag 
+     * @param description 
+     * @param compute 
+     */
+    void option(const std::string & flag, const Text & description, 
+                std::function<std::string()> compute);
 
     /**
      * @brief Register a new command to the program 
@@ -117,7 +287,93 @@ public:
      * @param description 
      */
     void command(const std::string & command, 
-                 const std::string & description = "");
+                 const Text & description = Text());
+
+    /**
+     * @brief Register a new command whose options and subcommands are defined
+     * by the builder, only if the parse selects the command (or the usage is 
+     * rendered). Startup does not pay for the commands that are not run.
+     * 
+     *      program.command("remote", "manage remotes", [](Commander & c) {
+     *          c.option("-f, --force", "force the operation");
+     *          c.command("add <name> <url>", "add a remote");
+     *      });
+     * 
+     * Subcommands are selected by the arg following their parent, and read as
+     * "remote add" from program["command"].
+     * 
+     * @param command 
+     * @param description 
+     * @param builder 
+     */
+    void command(const std::string & command, const Text & description, 
+                 Builder builder);
+
+    /**
+     * @brief Resolve the cold descriptions from the help file at the path. The
+     * file is mapped only when the usage or an error is rendered.
+     * 
+     * @param path 
+     */
+    void catalog(const std::string & path);
+
+    /**
+     * @brief Resolve the cold descriptions from a blob embedded in the binary
+     * 
+     * @param blob 
+     * @param size 
+     */
+    void catalog(const char *blob, std::size_t size) noexcept;
+
+    /**
+     * @brief Dispatch unknown commands to the external <name>-<command> exec
+     * -utables on the PATH, which replace the program with the rest of args.
+     * 
+     */
+    void external();
+
+    /**
+     * @brief Restrict the values of an arg, of an option or a command, to the
+     * choices. Checked in constant time whatever the number of choices.
+     * 
+     * @param arg 
+     * @param choices 
+     */
+    void choices(const std::string & arg, 
+                 const std::vector<std::string> & choices);
+
+    /**
+     * @brief Restrict the values of an arg to numbers in the range [min, max]
+     * 
+     * @param arg 
+     * @param min 
+     * @param max 
+     */
+    void range(const std::string & arg, double min, double max);
+
+    /**
+     * @brief Restrict the values of an arg to the ones matching the pattern,
+     * the pattern is compiled once here.
+     * 
+     * @param arg 
+     * @param pattern 
+     */
+    void pattern(const std::string & arg, const std::string & pattern);
+
+    /**
+     * @brief Enable a cache of parse results bounded to the given bytes, for 
+     * programs that parse the same command lines over and over.
+     * 
+     * @param bytes 
+     */
+    void cache(std::size_t bytes);
+
+    /**
+     * @brief Use a cache shared with other commanders of the same spec 
+     * 
+     * @param cache 
+     */
+    void cache(std::shared_ptr<Cache> cache) noexcept;
 
     //===-----------------------------------------------------------------===//
     //                                                                       //
@@ -134,12 +390,72 @@ public:
     void parse(int argc, char *argv[]);
 
     /**
-     * @brief list the available commands and options of the program
+     * @brief Parse the command and the options, but leave the args of the com
+     * -mand in argv, to be pulled one at a time with positionals(). Named args
+     * are still readable with [], variadic ones are not stored in values().
      * 
+     * @param argc 
+     * @param argv 
      */
-    void usage() const noexcept;
+    void stream(int argc, char *argv[]);
 
-    std::string operator[](const std::string key) const noexcept;
+    /**
+     * @brief Args of the command of the last stream(), read from argv as the 
+     * iteration reaches them.
+     * 
+     * @return Positionals 
+     */
+    Positionals positionals() const;
+
+    /**
+     * @brief list the available commands and options of the program, lazily 
+     * registered commands are all built first. Exits the process, except in an
+     * interactive session.
+     * 
+     */
+    void usage();
+
+    /**
+     * @brief Names of all the commands of the program, including subcommands
+     * of the lazily registered ones, which are built for it.
+     * 
+     * @return std::vector<std::string> 
+     */
+    std::vector<std::string> names();
+
+    /**
+     * @brief Result of the last parse, empty before the first parse
+     * 
+     * @return Result 
+     */
+    Result result() const noexcept { return this->parsed; }
+
+    /**
+     * @brief Counters of the parse cache, all zero if the cache is disabled, 
+     * and the allocations made by the last parse.
+     * 
+     * @return Stats 
+     */
+    Stats stats() const;
+
+    /**
+     * @brief Read a property of the last parse, the reference is valid until 
+     * the next parse. Absent option arguments read as their default value, if
+     * any, other missing properties as an empty string.
+     * 
+     * @param key 
+     * @return const std::string& 
+     */
+    const std::string & operator[](std::string_view key) const;
+
+    /**
+     * @brief Read all the values of an arg, given by a repeated option or a 
+     * variadic arg, the reference is valid until the next parse.
+     * 
+     * @param key 
+     * @return const Values& 
+     */
+    const Values & values(std::string_view key) const noexcept;
 };
 
 /**
@@ -151,7 +467,7 @@ public:
  */
 void Commander::version(const std::string & version, 
                         const std::string & flag, 
-                        const std::string & description) 
+                        const Text & description) 
 {
     this->properties.insert({properties::VERSION, version});
     this->option(flag, description);
@@ -163,7 +479,7 @@ void Commander::version(const std::string & version,
  * @param flag 
  * @param description 
  */
-void Commander::help(const std::string & flag, const std::string & description)
+void Commander::help(const std::string & flag, const Text & description)
 {
     this->option(flag, description);
 }
@@ -176,14 +492,62 @@ void Commander::help(const std::string & flag, const std::string & description)
  * @param description 
  * @throw cli::Exception 
  */
-void Commander::option(const std::string & flag, 
-                       const std::string & description)
+void Commander::option(const std::string & flag, const Text & description)
 {
     // check if the flag is empty or not, in any case flag must not be empty
     if (!flag.length()) throw Exception(errstr::option::FLAG_EMPTY);
 
-    // Create an Option and insert in the global options  
-    this->options.push_back(Option(flag, description));
+    // Create an Option and insert in the options of the scope
+    std::vector<Option> & options = this->registry();
+    options.push_back(Option(flag, description));
+    options.back().bind(this->help_catalog);
+}
+
+/**
+ * @brief add a new option with a default value
+ * 
+ * @param flag 
+ * @param description 
+ * @param value 
+ */
+void Commander::option(const std::string & flag, const Text & description, 
+                       const std::string & value)
+{
+    this->option(flag, description);
+    this->fallback(std::make_shared<Default>(value));
+}
+
+/**
+ * @brief add a new option with a lazily computed default value
+ * 
+ * @param flag 
+ * @param description 
+ * @param compute 
+ */
+void Commander::option(const std::string & flag, const Text & description, 
+                       std::function<std::string()> compute)
+{
+    this->option(flag, description);
+    this->fallback(std::make_shared<Default>(std::move(compute)));
+}
+
+/**
+ * @brief Give the option registered last a default value, which belongs to
+ * its first argument.
+ * 
+ * @param value 
+ * @throw cli::Exception if the option takes no argument
+ */
+void Commander::fallback(std::shared_ptr<Default> value)
+{
+    std::vector<Option> & options = this->registry();
+    if (!options.back().get_argv().size()) 
+    {
+        options.pop_back();
+        throw Exception(errstr::option::DEFAULT_NO_ARG);
+    }
+
+    options.back().set_default(std::move(value));
 }
 
 /**
@@ -193,45 +557,277 @@ void Commander::option(const std::string & flag,
  * @param description
  * @throw cli::Exception 
  */
-void Commander::command(const std::string & cmd, 
-                        const std::string & description)
+void Commander::command(const std::string & cmd, const Text & description)
 {
     // check if command string is empty or not, cmd must not be empty
     if (!cmd.length()) throw Exception("command cannot be empty");
 
     // Create an coommand and insert in the global commands 
-    this->commands.insert({Command(cmd, description), ""});
+    Command command(cmd, description);
+    command.bind(this->help_catalog);
+    command.nest(this->scope);
+    if (this->commands.count(command.getName()) || 
+        this->lazy.count(command.getName()))
+        throw Exception(errstr::parse::CMD_DUPLICATE + command.getName());
+    this->commands.insert({std::move(command), ""});
+}
+
+/**
+ * @brief add a new lazily built command to the program, only its name is read
+ * 
+ * @param cmd 
+ * @param description 
+ * @param builder 
+ * @throw cli::Exception 
+ */
+void Commander::command(const std::string & cmd, const Text & description, 
+                        Builder builder)
+{
+    const std::size_t first = cmd.find_first_not_of(" \t");
+    if (first == std::string::npos) throw Exception("command cannot be empty");
+
+    const std::size_t last = cmd.find_first_of(" \t", first);
+    std::string name = this->scope + cmd.substr(first, last - first);
+    if (this->commands.count(name) || this->lazy.count(name))
+        throw Exception(errstr::parse::CMD_DUPLICATE + name);
+    this->lazy[std::move(name)] = Lazy{cmd, description, std::move(builder)};
+}
+
+/**
+ * @brief Restrict the values of an arg to the choices
+ * 
+ * @param arg 
+ * @param choices 
+ */
+void Commander::choices(const std::string & arg, 
+                        const std::vector<std::string> & choices)
+{
+    this->validators[arg].set_choices(choices);
+}
+
+/**
+ * @brief Restrict the values of an arg to a numeric range
+ * 
+ * @param arg 
+ * @param min 
+ * @param max 
+ */
+void Commander::range(const std::string & arg, double min, double max)
+{
+    this->validators[arg].set_range(min, max);
+}
+
+/**
+ * @brief Restrict the values of an arg to a pattern
+ * 
+ * @param arg 
+ * @param pattern 
+ * @throw cli::Exception if the pattern is not a valid regex
+ */
+void Commander::pattern(const std::string & arg, const std::string & pattern)
+{
+    try { this->validators[arg].set_pattern(pattern); }
+    catch (const std::regex_error & e) 
+    {
+        throw Exception(errstr::option::INVALID_PATTERN + pattern, e.what());
+    }
+}
+
+/**
+ * @brief Resolve the cold descriptions from the help file
+ * 
+ * @param path 
+ */
+void Commander::catalog(const std::string & path)
+{
+    this->help_catalog->open(path);
+}
+
+/**
+ * @brief Resolve the cold descriptions from an embedded blob
+ * 
+ * @param blob 
+ * @param size 
+ */
+void Commander::catalog(const char *blob, std::size_t size) noexcept
+{
+    this->help_catalog->assign(blob, size);
+}
+
+/**
+ * @brief Enable the cache of parse results
+ * 
+ * @param bytes 
+ */
+void Commander::cache(std::size_t bytes)
+{
+    this->results = std::make_shared<Cache>(bytes);
+}
+
+/**
+ * @brief Use a shared cache of parse results
+ * 
+ * @param cache 
+ */
+void Commander::cache(std::shared_ptr<Cache> cache) noexcept
+{
+    this->results = std::move(cache);
+}
+
+/**
+ * @brief Enable the dispatch of unknown commands to external executables
+ * 
+ */
+void Commander::external()
+{
+    this->plugins = std::make_unique<Plugins>(this->name);
 }
 
 /**
- * @brief Parse the input args in the programs
+ * @brief Parse the input args in the programs, the commander can parse again
+ * for another command line, which replaces the previous result.
  * 
  * @param argc 
  * @param argv 
  */
 void Commander::parse(int argc, char *argv[])
+{
+    alloc::Scope scope;
+    this->parsed.reset();
+    this->streaming = false;
+
+    // Serve the previous result for the same args if cached, its command is
+    // selected as by the parse, a lazy one is built for its defaults
+    if (this->results)
+        if (Result hit = this->results->find(argc, argv)) {
+            this->parsed = std::move(hit);
+            auto name = this->parsed->properties.find(properties::command);
+            this->select(name != this->parsed->properties.end() 
+                            ? std::string_view(name->second) 
+                            : std::string_view());
+            this->parse_allocations = scope.count();
+            return;
+        }
+
+    this->run(argc, argv);
+    if (this->results) this->results->insert(argc, argv, this->parsed);
+
+    this->parse_allocations = scope.count();
+}
+
+/**
+ * @brief Parse the command and the options, leaving the command's args in argv
+ * 
+ * @param argc 
+ * @param argv 
+ */
+void Commander::stream(int argc, char *argv[])
+{
+    alloc::Scope scope;
+    this->parsed.reset();
+
+    this->streaming = true;
+    this->run(argc, argv);
+
+    this->parse_allocations = scope.count();
+}
+
+/**
+ * @brief Args of the command of the last stream()
+ * 
+ * @return Positionals 
+ */
+Positionals Commander::positionals() const
+{
+    if (!this->streaming || !this->selected) return Positionals();
+
+    // the args are checked by the validator of their name as they are pulled
+    const std::vector<std::string> & keys = this->selected->getargv();
+    Positionals::Check check;
+    if (keys.size()) check = [this, &keys](std::size_t i, std::string_view v) {
+        const std::string & key = keys[std::min(i, keys.size() - 1)];
+        if (i >= keys.size() && !this->selected->isVariadic()) return;
+
+        auto itr = this->validators.find(key);
+        if (itr != this->validators.end()) itr->second.check(key, v);
+    };
+    return Positionals(this->stream_first, this->stream_last, std::move(check));
+}
+
+/**
+ * @brief Run the parse pipeline and publish the result, nothing is published
+ * by a failed parse.
+ * 
+ * @param argc 
+ * @param argv 
+ */
+void Commander::run(int argc, char *argv[])
 {
     // Update the this->args from provided arguemtns 
+    this->reset();
     this->populate(argc, argv);
     
     // If no arguments are provided, display the usage
-    if (!this->option_args.size() && !this->command_args.size()) this->usage();
+    bool shown = !this->option_args.size() && !this->command_args.size();
+    if (shown) this->usage();
 
     // This is to obey the legacy of -v|--version and -h|--help. 
     // usage if --version|-v is provided and and this->properties has a version 
-    // field then display the version
-    this->is_cmd_version();
-    this->is_cmd_help();
+    // field then display the version. In a session they return, with no command
+    shown = shown || this->is_cmd_version() || this->is_cmd_help();
 
-    // Identify and process commands 
-    this->parse_cmd();
+    try
+    {
+        // Identify and process commands 
+        if (!shown) this->parse_cmd();
 
-    // Identify and process options 
-    this->parse_options();
+        // Identify and process options 
+        if (!shown) this->parse_options();
+    }
+    catch (...)
+    {
+        // the properties of the failed parse are not read by []
+        this->reset();
+        throw;
+    }
+
+    // the result of the previous parse is reused if nobody holds it, a map of
+    // the same keys is assigned value by value so that the values keep their
+    // buffers
+    auto assign = [](auto & to, const auto & from) {
+        auto same = [](auto & a, auto & b) { return a.first == b.first; };
+        if (to.size() != from.size() || 
+            !std::equal(to.begin(), to.end(), from.begin(), same)) to = from;
+        else for (auto t = to.begin(), f = from.begin(); f != from.end(); )
+            (t++)->second = (f++)->second;
+    };
+    if (!this->published || this->published.use_count() > 1)
+        this->published = std::make_shared<Parsed>();
+    assign(this->published->properties, this->properties);
+    assign(this->published->lists, this->lists);
+    this->parsed = this->published;
+
+    this->spare_properties.reserve(this->properties.size());
+    this->spare_lists.reserve(this->lists.size());
 }
 
-void Commander::usage() const noexcept
+/**
+ * @brief Counters of the parse cache
+ * 
+ * @return Stats 
+ */
+Stats Commander::stats() const
 {
+    Stats s = this->results ? this->results->stats() : Stats();
+    s.parse = this->parse_allocations;
+    return s;
+}
+
+void Commander::usage()
+{
+    // the usage lists the whole tree, build the lazy commands
+    this->materialize();
+
     std::cout << "\n" << LEFT_PAD  << _P(this->name) << " " 
               << this->description << "\n";
 
@@ -239,24 +835,87 @@ void Commander::usage() const noexcept
     for (auto &command : this->commands) std::cout << command.first 
                                                    << std::endl;
 
+    for (auto & cmd : this->external_names())
+        std::cout << LEFT_PAD << std::setw(30) << std::left << _S(cmd) << " " 
+                  << this->name << "-" << cmd << std::endl;
+
     std::cout << "\nAvailable options:\n";
     for (auto &el : this->options) std::cout << el << std::endl;
-    std::exit(0);
+
+    for (auto & [cmd, options] : this->scoped)
+    {
+        std::cout << "\nOptions of " << _S(cmd) << ":\n";
+        for (auto & el : options) std::cout << el << std::endl;
+    }
+    if (this->exits) std::exit(0);
 }
 
 /**
  * @brief Overload [] for Commander
  * 
  * @param key 
- * @return std::string 
+ * @return const std::string& 
  */
-std::string Commander::operator[](const std::string key) const noexcept
+const std::string & Commander::operator[](std::string_view key) const
 {
-    auto itr = this->properties.find(key);
-    if (this->properties.find(key) != this->properties.end()) 
-        return itr->second;
-    
-    return "";
+    static const std::string empty;
+    const Properties & props = this->parsed ? this->parsed->properties 
+                                            : this->properties;
+
+    auto itr = props.find(key);
+    if (itr != props.end()) return itr->second;
+
+    // the default of an option accepted for the command of the parse, an arg
+    // of the command itself has none
+    const Command *cmd = nullptr;
+    auto name = props.find(properties::command);
+    if (name != props.end())
+    {
+        auto f = this->commands.find(name->second);
+        if (f != this->commands.end()) cmd = &f->first;
+    }
+    if (cmd) for (auto & arg : cmd->getargv()) if (arg == key) return empty;
+
+    Default *value = nullptr;
+    this->each_option(cmd, [&](const Option & el) {
+        if (!value && el.get_default() && el.get_argv().front().first == key) 
+            value = el.get_default();
+    });
+    return value ? value->get() : empty;
+}
+
+/**
+ * @brief Read all the values of an arg
+ * 
+ * @param key 
+ * @return const Values& 
+ */
+const Values & Commander::values(std::string_view key) const noexcept
+{
+    static const Values empty;
+    if (!this->parsed) return empty;
+
+    auto itr = this->parsed->lists.find(key);
+    return itr != this->parsed->lists.end() ? itr->second : empty;
+}
+
+/**
+ * @brief Clear the state of a previous parse, properties registered with the
+ * spec (version) are kept.
+ * 
+ */
+void Commander::reset()
+{
+    this->command_args.clear();
+    this->option_args.clear();
+    this->selected = nullptr;
+
+    // the nodes are kept for the next parse, with the buffers of their values
+    while (this->lists.size()) 
+        this->spare_lists.push_back(this->lists.extract(this->lists.begin()));
+    for (auto itr = this->properties.begin(); itr != this->properties.end();)
+        if (itr->first == properties::VERSION) itr++;
+        else this->spare_properties.push_back(this->properties.extract(itr++));
 }
 
 /**
@@ -268,13 +927,19 @@ std::string Commander::operator[](const std::string key) const noexcept
 void Commander::populate(int argc, char *argv[]) 
 {
     int i = 1;
-    for(; i < argc && strlen(argv[i]) && argv[i][0] != '-'; i++) 
-        this->command_args.push_back(std::string(argv[i]));
+    // when streaming only the command name is read, its args are left in argv,
+    // a negative number after the command name is one of its args
+    for(; i < argc && argv[i][0] && (argv[i][0] != '-' || 
+                      (i > 1 && helper::is_number(argv[i]))); i++) 
+        if (!this->streaming || i == 1) this->command_args.push_back(argv[i]);
+
+    if (this->streaming) 
+        this->stream_first = argv + std::min(i, 2), this->stream_last = argv + i;
 
-    for(; i < argc; i++) this->option_args.push_back(std::string(argv[i]));
+    for(; i < argc; i++) this->option_args.push_back(argv[i]);
 }
 
-void Commander::is_cmd_version()
+bool Commander::is_cmd_version()
 {
     if (this->option_args.size() && 
         this->properties.find(properties::VERSION) != this->properties.end() && 
@@ -282,79 +947,433 @@ void Commander::is_cmd_version()
          *this->option_args.begin() == "-v" ))
     {
         std::cout << this->properties[properties::VERSION] << std::endl;
-        std::exit(0);
+        if (this->exits) std::exit(0);
+        return true;
     }
+    return false;
 }
 
-void Commander::is_cmd_help()
+bool Commander::is_cmd_help()
 {
     if (this->option_args.size() && this->properties.find(properties::VERSION) != this->properties.end()
             && (*this->option_args.begin() == "--help" || *this->option_args.begin() == "-h" ))
     {
         this->usage();
-        std::exit(0);
+        return true;
     }
+    return false;
 }
 
 void Commander::parse_cmd()
 {
     if (this->command_args.size())
     {
-        std::string cmd_name = this->command_args.front();
-        auto f = this->commands.find(cmd_name);
+        std::string cmd_name(this->command_args.front());
+        auto f = this->find_cmd(cmd_name);
 
         if (f != this->commands.end())
         {
-            auto command = f->first;
-            // Update properties and pop out the first element which was command name
-            this->properties.insert({properties::command, cmd_name});
+            // pop out the first element which was command name
             this->command_args.erase(command_args.begin(), command_args.begin() + 1);
 
+            // descend into the subcommands, each one named by the next arg
+            while (this->has_subcommands(cmd_name))
+            {
+                std::string_view next;
+                if (this->streaming && this->stream_first != this->stream_last) 
+                    next = *this->stream_first;
+                else if (!this->streaming && this->command_args.size()) 
+                    next = this->command_args.front();
+
+                if (next.empty()) break;
+
+                auto sub = this->find_cmd(cmd_name + " " + std::string(next));
+                if (sub == this->commands.end()) break;
+
+                cmd_name = sub->first.getName(), f = sub;
+                if (this->streaming) this->stream_first++;
+                else this->command_args.erase(command_args.begin());
+            }
+
+            const Command & command = f->first;
+            this->selected = &command;
+            // Update properties
+            this->entry(this->properties, this->spare_properties, 
+                        properties::command) = cmd_name;
+
+            // when streaming only the named args are read from argv, the count
+            // of args is known without reading them
+            const std::vector<std::string> & keys = command.getargv();
+            if (this->streaming)
+                for (char **arg = this->stream_first; arg != this->stream_last && 
+                     this->command_args.size() < keys.size(); arg++)
+                    this->command_args.push_back(*arg);
+
+            const std::size_t given = this->streaming 
+                                        ? this->stream_last - this->stream_first
+                                        : this->command_args.size();
+
             //Validate Command args and Update the properties 
-            if (command.validate(this->command_args.size())) 
+            if (command.validate(given)) 
             {
-                std::vector<std::string> keys = command.getargv();
-                for(int i = 0; i < this->command_args.size() && i < keys.size(); i++)
-                    this->properties.insert({keys[i], this->command_args[i]});
+                for(std::size_t i = 0; 
+                    i < this->command_args.size() && i < keys.size(); i++)
+                {
+                    // a variadic arg takes all the remaining args
+                    const bool rest = command.isVariadic() && i + 1 == keys.size();
+                    auto last = rest ? this->command_args.end() 
+                                     : this->command_args.begin() + i + 1;
+                    this->entry(this->properties, this->spare_properties, 
+                                keys[i]) = this->command_args[i];
+                    if (!this->streaming || !rest)
+                        this->store(keys[i], this->command_args.begin() + i, last);
+                }
             }
             else {
                 std::cout << command << std::endl;
                 throw Exception(errstr::parse::CMD_MISSING_ARG);
             }
         }
-        else throw Exception(errstr::parse::CMD_NOT_FOUND);
+        else if (this->plugins && this->dispatch(cmd_name)) {}
+        else throw Exception(errstr::parse::CMD_NOT_FOUND, 
+                             this->suggest_cmd(cmd_name));
     }
     
 }
 
+/**
+ * @brief Append the values to the list of the arg, stored contiguously
+ * 
+ * @param key 
+ * @param first 
+ * @param last 
+ */
+void Commander::store(const std::string & key, 
+                      std::vector<std::string_view>::const_iterator first,
+                      std::vector<std::string_view>::const_iterator last)
+{
+    // check the values before they are stored
+    auto validator = this->validators.find(key);
+    if (validator != this->validators.end())
+        for (auto itr = first; itr != last; itr++) 
+            validator->second.check(key, *itr);
+
+    Values & values = this->entry(this->lists, this->spare_lists, key);
+
+    // size the buffer once for variadic args, repeated options just append
+    if (last - first > 1)
+    {
+        std::size_t length = 0;
+        for (auto itr = first; itr != last; itr++) length += itr->size();
+        values.reserve(last - first, length);
+    }
+
+    for (; first != last; first++) values.push(*first);
+}
+
+/**
+ * @brief Find a command by its full name, a lazily registered command is built
+ * when found, which runs its builder.
+ * 
+ * @param name 
+ * @return Commands::const_iterator 
+ */
+Commander::Commands::const_iterator Commander::find_cmd(std::string_view name)
+{
+    auto f = this->commands.find(name);
+    if (f != this->commands.end()) return f;
+
+    auto itr = this->lazy.find(name);
+    if (itr == this->lazy.end()) return this->commands.end();
+
+    // take the entry out before building, the builder may register more
+    std::string full(itr->first);
+    Lazy entry = std::move(itr->second);
+    this->lazy.erase(itr);
+
+    const std::string parent = this->scope;
+    this->scope = full.substr(0, full.rfind(' ') + 1);
+    this->command(entry.spec, entry.description);
+
+    this->scope = full + " ";
+    try { entry.builder(*this); }
+    catch (...) { this->scope = parent; throw; }
+    this->scope = parent;
+
+    return this->commands.find(full);
+}
+
+/**
+ * @brief Check if any subcommand is nested under the command
+ * 
+ * @param cmd 
+ * @return true 
+ * @return false 
+ */
+bool Commander::has_subcommands(const std::string & cmd) const
+{
+    const std::string scope = cmd + " ";
+    auto c = this->commands.lower_bound(scope);
+    auto l = this->lazy.lower_bound(scope);
+
+    return (c != this->commands.end() && 
+            !c->first.getName().compare(0, scope.size(), scope)) ||
+           (l != this->lazy.end() && !l->first.compare(0, scope.size(), scope));
+}
+
+/**
+ * @brief Select the command of the given full name, the lazy commands on its
+ * path are built, as the parse builds them. None is selected for no name.
+ * 
+ * @param name 
+ */
+void Commander::select(std::string_view name)
+{
+    Commands::const_iterator f = this->commands.end();
+    for (std::size_t end = 0; name.size() && end != name.npos;)
+    {
+        end = name.find(' ', end + 1);
+        f = this->find_cmd(name.substr(0, end));
+    }
+    this->selected = f != this->commands.end() ? &f->first : nullptr;
+}
+
+/**
+ * @brief Build all the lazily registered commands, including the ones their
+ * builders register.
+ * 
+ */
+void Commander::materialize()
+{
+    while (this->lazy.size()) this->find_cmd(this->lazy.begin()->first);
+}
+
+/**
+ * @brief Names of all the commands
+ * 
+ * @return std::vector<std::string> 
+ */
+std::vector<std::string> Commander::names()
+{
+    this->materialize();
+
+    std::vector<std::string> names;
+    names.reserve(this->commands.size());
+    for (auto & el : this->commands) names.push_back(el.first.getName());
+    return names;
+}
+
+/**
+ * @brief Suggest the nearest registered command for an unknown one
+ * 
+ * @param cmd 
+ * @return std::string 
+ */
+std::string Commander::suggest_cmd(const std::string & cmd) const
+{
+    std::vector<std::string_view> candidates;
+    candidates.reserve(this->commands.size());
+    for (auto & el : this->commands) candidates.push_back(el.first.getName());
+    for (auto & el : this->lazy) candidates.push_back(el.first);
+
+    const std::vector<std::string> external = this->external_names();
+    for (auto & el : external) candidates.push_back(el);
+
+    return helper::did_you_mean(cmd, candidates);
+}
+
+/**
+ * @brief Names of the external commands, for the usage and the suggestions.
+ * They are only informative, a PATH that cannot be scanned lists none.
+ * 
+ * @return std::vector<std::string> 
+ */
+std::vector<std::string> Commander::external_names() const
+{
+    if (!this->plugins) return {};
+
+    try { return this->plugins->list(); }
+    catch (const std::exception &) { return {}; }
+}
+
+/**
+ * @brief Replace the process with the external command if one exists, the
+ * remaining args are passed in their original order. An interactive session
+ * is never replaced, external commands are not run from it.
+ * 
+ * @param cmd 
+ * @return false if there is no such external command, or in a session
+ */
+bool Commander::dispatch(const std::string & cmd)
+{
+    if (!this->exits) return false;
+
+    const std::string path = this->plugins->find(cmd);
+    if (path.empty()) return false;
+
+    std::vector<std::string> args{this->name + "-" + cmd};
+    if (this->streaming) 
+        args.insert(args.end(), this->stream_first, this->stream_last);
+    else 
+        args.insert(args.end(), this->command_args.begin() + 1, 
+                                this->command_args.end());
+    args.insert(args.end(), this->option_args.begin(), this->option_args.end());
+
+    Plugins::exec(path, args);
+}
+
+/**
+ * @brief Suggest the nearest flag accepted for the command, both aliases of 
+ * every option are considered.
+ * 
+ * @param flag 
+ * @param cmd 
+ * @return std::string 
+ */
+std::string Commander::suggest_option(std::string_view flag, 
+                                      const Command *cmd) const
+{
+    std::vector<std::string_view> candidates;
+    this->each_option(cmd, [&](const Option & el) {
+        candidates.push_back(el.get_flag());
+        candidates.push_back(el.get_secondary_flag());
+    });
+
+    return helper::did_you_mean(flag, candidates);
+}
+
+/**
+ * @brief Options of the scope being registered, the global ones or the ones 
+ * of the command whose builder is running.
+ * 
+ * @return std::vector<Option>& 
+ */
+std::vector<Option> & Commander::registry()
+{
+    if (this->scope.empty()) return this->options;
+    return this->scoped[this->scope.substr(0, this->scope.size() - 1)];
+}
+
+/**
+ * @brief Entry of the key in the map, inserted as a node left by the previous
+ * parse if any, the node of the same key first, so that its value keeps the 
+ * buffer it had.
+ * 
+ * @param map 
+ * @param spare 
+ * @param key 
+ * @return Map::mapped_type& 
+ */
+template <class Map>
+typename Map::mapped_type & 
+Commander::entry(Map & map, std::vector<typename Map::node_type> & spare,
+                 std::string_view key)
+{
+    auto itr = map.find(key);
+    if (itr != map.end()) return itr->second;
+    if (spare.empty()) 
+        return map.emplace(key, typename Map::mapped_type()).first->second;
+
+    auto same = std::find_if(spare.begin(), spare.end(), [&](auto & node) {
+        return node.key() == key;
+    });
+    if (same != spare.end()) std::swap(*same, spare.back());
+
+    typename Map::node_type node = std::move(spare.back());
+    spare.pop_back();
+    node.key() = key;
+    node.mapped().clear();
+    return map.insert(std::move(node)).position->second;
+}
+
+/**
+ * @brief Call the function with every option accepted for the command, the 
+ * global ones and the ones of the command and of its parents.
+ * 
+ * @param cmd null for the options of no command
+ * @param fn 
+ */
+template <class Fn>
+void Commander::each_option(const Command *cmd, Fn && fn) const
+{
+    for (auto & el : this->options) fn(el);
+    if (!cmd) return;
+
+    std::string_view name = cmd->getName();
+    for (;;)
+    {
+        auto itr = this->scoped.find(name);
+        if (itr != this->scoped.end()) for (auto & el : itr->second) fn(el);
+
+        const std::size_t space = name.rfind(' ');
+        if (space == name.npos) break;
+        name = name.substr(0, space);
+    }
+}
+
+/**
+ * @brief Find the option of the flag accepted for the command
+ * 
+ * @param flag 
+ * @param cmd 
+ * @return Option* null if there is none
+ */
+Option * Commander::find_option(std::string_view flag, const Command *cmd)
+{
+    const Option *found = nullptr;
+    this->each_option(cmd, [&](const Option & el) {
+        if (!found && el == flag) found = &el;
+    });
+    return const_cast<Option *>(found);
+}
+
 void Commander::parse_options()
 {
     if (this->option_args.size()) 
     {
-        int i = 0;
+        std::size_t i = 0;
         for(; i < this->option_args.size(); i++)
         {
-            if (this->option_args[i].front() != '-') continue;
-
-            Option *option = nullptr;
-            // find the flag in the options 
-            for (auto & el : this->options) if (el == this->option_args[i]) {
-                option = &el;
-                std::vector<std::string> args;
-                for(int j = i + 1; j < this->option_args.size() && 
-                                   this->option_args[j].front() != '-'; j++) 
-                    args.push_back(this->option_args[j]);
-
-                option->parse(args);
-                // update properties 
-                auto a = option->get_argv();         
-                std::cout << "\n" << *option << std::endl;
-                break;
+            if (!helper::is_flag(this->option_args[i])) continue;
+
+            // find the flag in the options of the selected command
+            Option *option = this->find_option(this->option_args[i], 
+                                                this->selected);
+            if (!option) 
+                throw Exception(errstr::parse::OPTION_NOT_FOUND + 
+                                std::string(this->option_args[i]), 
+                                this->suggest_option(this->option_args[i],
+                                                     this->selected));
+
+            // a negative number is a value as long as the option wants one
+            std::vector<std::string_view> & args = this->option_values;
+            args.clear();
+            std::size_t j = i + 1;
+            for(; j < this->option_args.size(); j++)
+            {
+                std::string_view arg = this->option_args[j];
+                const bool wanted = option->is_variadic() ||
+                    args.size() < std::size_t(option->get_maxargs());
+                if (helper::is_flag(arg) && !(wanted && helper::is_number(arg)))
+                    break;
+                args.push_back(arg);
+            }
+            i = j - 1;
+
+            option->parse(args);
+            // update properties with the option's arguments, the values of
+            // every occurrence are kept in the lists
+            const auto & argv = option->get_argv();
+            for (std::size_t k = 0; k < argv.size() && k < args.size(); k++)
+            {
+                const bool rest = option->is_variadic() && k + 1 == argv.size();
+                auto last = rest ? args.end() : args.begin() + k + 1;
+                this->entry(this->properties, this->spare_properties, 
+                            argv[k].first) = *(last - 1);
+                this->store(argv[k].first, args.begin() + k, last);
             }
         }
     }
-    exit(0);
-    
 }
 
 } // namespace Commander
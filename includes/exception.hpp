@@ -31,6 +31,11 @@ namespace errstr
                                               per options are allowed";
         static std::string INVALID_ARG = "Invalid argument provided";
         static std::string ARG_MISSING = "argument required";
+        static std::string INVALID_PATTERN = "Invalid pattern ";
+        static std::string DEFAULT_NO_ARG = "Default value given for an option "
+                                            "without argument";
+        static std::string VARIADIC_NOT_LAST = "Only the last argument can be "
+                                               "variadic";
     }
 
     namespace parse
@@ -38,6 +43,10 @@ namespace errstr
         static std::string MISSING_CMD = "Command not provided";
         static std::string CMD_NOT_FOUND = "Command not found";
         static std::string CMD_MISSING_ARG = "Missing command args";
+        static std::string CMD_DUPLICATE = "Command already registered ";
+        static std::string OPTION_NOT_FOUND = "Unknown option ";
+        static std::string EXEC_FAILED = "Failed to run external command ";
+        static std::string INVALID_VALUE = "Invalid value ";
     }
 
 } // errstr
@@ -16,6 +16,9 @@
 #include <regex>
 #include <algorithm>
 #include <cctype>
+#include <cstdint>
+#include <charconv>
+#include <string_view>
 #include <exception.hpp>
 #include <locale>
 
@@ -82,6 +85,143 @@ std::pair<std::string, int> process_arg(const std::string & argument)
     return {arg_name, (argument.front() == '<') ? 1 : 0};
 }
 
+/**
+ * @brief Check if a runtime arg is a flag
+ * 
+ * @param arg 
+ * @return true 
+ * @return false 
+ */
+bool is_flag(std::string_view arg) noexcept
+{
+    return arg.size() && arg.front() == '-';
+}
+
+/**
+ * @brief Check if a runtime arg is a number, a negative number starts like a
+ * flag but is read as a value where one is expected
+ * 
+ * @param arg 
+ * @return true 
+ * @return false 
+ */
+bool is_number(std::string_view arg) noexcept
+{
+    double number = 0;
+    const char *last = arg.data() + arg.size();
+    auto res = std::from_chars(arg.data(), last, number);
+    return arg.size() && res.ec == std::errc() && res.ptr == last;
+}
+
+/**
+ * @brief Strip the '...' suffix of a variadic argument name
+ * 
+ * @param name 
+ * @return true if the argument is variadic
+ */
+bool variadic(std::string & name)
+{
+    if (name.size() <= 3 || name.compare(name.size() - 3, 3, "...")) 
+        return false;
+
+    name.erase(name.size() - 3);
+    return true;
+}
+
+/**
+ * @brief Levenshtein distance between the pattern and the text, computed with
+ * the bit-parallel algorithm of Myers (as adapted by Hyyro for global distan
+ * -ce). The pattern must be at most 64 characters long and its match vectors 
+ * are precomputed by the caller, so that one pattern can be compared against 
+ * many texts. Returns max + 1 as soon as the distance is known to exceed max.
+ * 
+ * @param peq 
+ * @param m 
+ * @param text 
+ * @param max 
+ * @return std::size_t 
+ */
+std::size_t distance(const uint64_t (&peq)[256], std::size_t m, 
+                     std::string_view text, std::size_t max)
+{
+    const std::size_t n = text.size();
+    if ((m > n ? m - n : n - m) > max) return max + 1;
+    if (!m) return n;
+
+    const uint64_t last = uint64_t(1) << (m - 1);
+    uint64_t pv = ~uint64_t(0), mv = 0;
+    std::size_t score = m;
+
+    for (std::size_t j = 0; j < n; j++)
+    {
+        const uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) score++;
+        else if (mh & last) score--;
+
+        // the remaining characters can lower the score by at most one each 
+        if (score > max + (n - j - 1)) return max + 1;
+
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return score;
+}
+
+/**
+ * @brief Find the nearest candidate to the given word, used for the "did you 
+ * mean" hints. Candidates further than a third of the word's length, or one 
+ * edit for short words, are not considered, nor the ones that would replace 
+ * the whole word. Returns an empty string if nothing is close enough.
+ * 
+ * @param word 
+ * @param candidates 
+ * @return std::string 
+ */
+std::string suggest(std::string_view word, 
+                    const std::vector<std::string_view> & candidates)
+{
+    const std::size_t m = word.size();
+    if (!m || m > 64) return "";
+
+    uint64_t peq[256] = {};
+    for (std::size_t i = 0; i < m; i++) 
+        peq[static_cast<unsigned char>(word[i])] |= uint64_t(1) << i;
+
+    // the cutoff shrinks with every better candidate found
+    std::size_t best = std::max<std::size_t>(1, m / 3) + 1;
+    std::string_view match;
+    for (auto & candidate : candidates)
+    {
+        if (candidate.empty()) continue;
+        std::size_t d = distance(peq, m, candidate, best - 1);
+        if (d < best && d < m) best = d, match = candidate;
+    }
+
+    return std::string(match);
+}
+
+/**
+ * @brief Build the fix string for an unrecognized command or option 
+ * 
+ * @param word 
+ * @param candidates 
+ * @return std::string 
+ */
+std::string did_you_mean(std::string_view word, 
+                         const std::vector<std::string_view> & candidates)
+{
+    std::string match = suggest(word, candidates);
+    return match.empty() ? "" : "Did you mean '" + match + "'?";
+}
+
 } // namespace helper
 
 } // namespace cli
@@ -17,11 +17,43 @@
 #include <ostream>
 #include <helper.hpp>
 #include <colors.hpp>
+#include <text.hpp>
 #include <utility>
+#include <functional>
+#include <mutex>
 
 namespace cli
 {
 
+/**
+ * @brief Default value of an option's argument, either given as it is or
+ * computed by a callable. The callable runs only when the option is absent and
+ * the value is read, at most once for the whole process even with concurrent
+ * readers, and its result is kept.
+ */
+class Default
+{
+    std::function<std::string()> compute;
+    std::once_flag once;
+    std::string value;
+
+public:
+    explicit Default(std::string v) : value(std::move(v)) {}
+    explicit Default(std::function<std::string()> f) : compute(std::move(f)) {}
+
+    /**
+     * @brief Read the value, computing it on the first read
+     * 
+     * @return const std::string& 
+     */
+    const std::string & get()
+    {
+        if (this->compute) 
+            std::call_once(this->once, [this] { this->value = this->compute(); });
+        return this->value;
+    }
+};
+
 class Option
 {
     /**
@@ -46,11 +78,18 @@ class Option
     int present = 0;
 
     /**
-     * @brief Usuage string for the option, same as the string provided at the 
-     * runtime.
+     * @brief whether the last argument is variadic ('<name...>'), which takes
+     * all the following values and accumulates over repeated occurrences.
      * 
      */
-    std::string usuage;
+    bool variadic = false;
+
+    /**
+     * @brief kinds of the arguments in their order, the bit of an optional 
+     * ('[]') argument is set. Options take at most 64 arguments.
+     * 
+     */
+    uint64_t optional = 0;
 
     /**
      * @brief primary identifier for the option, it can be both, but if small f
@@ -72,7 +111,7 @@ class Option
      * -sage.
      * 
      */
-    std::string description;
+    Text description;
 
     /**
      * @brief Vector of Option args names, and their values 
@@ -80,8 +119,24 @@ class Option
      */
     std::vector<std::pair<std::string, std::string>> args;
 
+    /**
+     * @brief default value of the first argument, null if there is none
+     * 
+     */
+    std::shared_ptr<Default> fallback;
+
 public:
-    Option(const std::string & flag, const std::string & description = "");
+    Option(const std::string & flag, const Text & description = Text());
+
+    /**
+     * @brief Bind a cold description to the help catalog
+     * 
+     * @param catalog 
+     */
+    void bind(const std::shared_ptr<const Catalog> & catalog)
+    {
+        this->description.bind(catalog);
+    }
 
     //===-----------------------------------------------------------------===//
     //                                                                       //
@@ -89,14 +144,59 @@ public:
     //                                                                       //
     //===-----------------------------------------------------------------===//
 
-    void parse(std::vector<std::string> & args);
+    void parse(const std::vector<std::string_view> & args);
 
     /**
-     * @brief Get a copy of option's arguments vector. 
+     * @brief Get the option's arguments, their names and the values of the
+     * last occurrence.
      *
-     * @return std::vector<std::pair<std::string, std::string>> 
+     * @return const std::vector<std::pair<std::string, std::string>>& 
+     */
+    const std::vector<std::pair<std::string, std::string>> & get_argv() const;
+
+    /**
+     * @brief Whether the last argument of the option is variadic
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool is_variadic() const noexcept { return this->variadic; }
+
+    /**
+     * @brief Default value of the first argument, read when it is absent
+     * 
+     * @param value 
      */
-    std::vector<std::pair<std::string, std::string>> get_argv() const;
+    void set_default(std::shared_ptr<Default> value) noexcept
+    {
+        this->fallback = std::move(value);
+    }
+    Default * get_default() const noexcept { return this->fallback.get(); }
+
+    /**
+     * @brief Number of required arguments, and the maximum number of them
+     * 
+     * @return int 
+     */
+    int get_required() const noexcept { return this->required; }
+    int get_maxargs() const noexcept { return this->maxargs; }
+
+    /**
+     * @brief Get the primary flag of the option
+     * 
+     * @return const std::string& 
+     */
+    const std::string & get_flag() const noexcept { return this->flag; }
+
+    /**
+     * @brief Get the secondary flag of the option, empty if no alias is given
+     * 
+     * @return const std::string& 
+     */
+    const std::string & get_secondary_flag() const noexcept 
+    { 
+        return this->secondary_flag; 
+    }
     
     /**
      * @brief Overload the == operator, to check with string 
@@ -105,7 +205,7 @@ public:
      * @return true 
      * @return false 
      */
-    bool operator==(const std::string & f) const noexcept;
+    bool operator==(std::string_view f) const noexcept;
 
     /**
      * @brief Overload the == operator according to Option object
@@ -132,15 +232,14 @@ public:
  * @param flag 
  * @param description 
  */
-Option::Option(const std::string & flag, const std::string & description)
+Option::Option(const std::string & flag, const Text & description)
 {
     this->description = description;
-    this->usuage = std::regex_replace(flag, std::regex(R"([|]+)"), ", ");
     // process the flag type. if the flag has arguments, then update the requir
     // -ed according to <> or [] provided
     const std::vector<std::string> tokenized = helper::tokenize(flag, 
                                                      std::regex(R"([\s|,]+)"));
-    int idx = 0;
+    std::size_t idx = 0;
     // check the syntax of the option and build according to it Update the prim
     // -ary identifer (flag) of this option
     if (tokenized.size() == 0 || (tokenized.size() && 
@@ -162,26 +261,39 @@ Option::Option(const std::string & flag, const std::string & description)
     for (; idx < tokenized.size(); idx++) 
     {
         auto arg = helper::process_arg(tokenized[idx]);
+        if (this->variadic) throw Exception(errstr::option::VARIADIC_NOT_LAST);
+        if (this->args.size() == 64) throw Exception(errstr::option::INVALID_SYNTAX);
+        this->variadic = helper::variadic(arg.first);
+        if (!arg.second) this->optional |= uint64_t(1) << this->args.size();
         
         this->args.push_back({arg.first, ""});
         this->required += arg.second, this->maxargs++;
     }
 }
 
-void Option::parse(std::vector<std::string> & args)
+/**
+ * @brief Validate the values of an occurrence of the option, and keep them as
+ * the values of the last occurrence.
+ * 
+ * @param args 
+ */
+void Option::parse(const std::vector<std::string_view> & args)
 {
-    if (args.size() < this->required) throw Exception(errstr::option::ARG_MISSING);
+    if (args.size() < std::size_t(this->required)) throw Exception(errstr::option::ARG_MISSING);
     
-    for(int i = 0; i < args.size() && i < this->maxargs; i++) 
+    // forget the values of a previous parse
+    for (auto & arg : this->args) arg.second.clear();
+    for(std::size_t i = 0; 
+        i < args.size() && i < std::size_t(this->maxargs); i++) 
         this->args[i].second = args[i];
 }
 
 /**
- * @brief Get a copy of option's arguments vector. 
+ * @brief Get the option's arguments
  * 
- * @return std::vector<std::pair<std::string, std::string>> 
+ * @return const std::vector<std::pair<std::string, std::string>>& 
  */
-std::vector<std::pair<std::string, std::string>> Option::get_argv() const
+const std::vector<std::pair<std::string, std::string>> & Option::get_argv() const
 {
     return this->args;
 }
@@ -193,7 +305,7 @@ std::vector<std::pair<std::string, std::string>> Option::get_argv() const
  * @return true 
  * @return false 
  */
-bool Option::operator==(const std::string & f) const noexcept
+bool Option::operator==(std::string_view f) const noexcept
 {
     return (f == this->flag || f == this->secondary_flag) ? true : false;
 }
@@ -219,10 +331,21 @@ bool Option::operator==(const Option & o) const noexcept
  */
 std::ostream& operator<<(std::ostream & os, const Option & o)
 {
+    // rebuild the usage from the flags and the arguments in their order
+    std::string usage = o.flag;
+    if (o.secondary_flag.length()) usage += ", " + o.secondary_flag;
+    for (std::size_t i = 0; i < o.args.size(); i++) 
+    {
+        const std::string dots = (o.variadic && i + 1 == o.args.size()) ? "..." 
+                                                                         : "";
+        usage += (o.optional >> i & 1) ? " [" + o.args[i].first + dots + "]"
+                                       : " <" + o.args[i].first + dots + ">";
+    }
+
     os << LEFT_PAD 
        << std::setw(30) 
        << std::left 
-       << _T(o.usuage + " ");
+       << _T(usage + " ");
 
     os << o.description;
     return os;
@@ -0,0 +1,329 @@
+// -*- C++ -*-
+//===----------------------------- plugin.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_PLUGIN_HPP
+#define CLI_PLUGIN_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <exception.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief Index of the external commands of a program, the executables named
+ * <program>-<command> found on the PATH, git style.
+ *
+ * Discovering them means reading every directory of the PATH, so the index is
+ * kept in a per user cache file ($XDG_CACHE_HOME/<program>/plugins) along with
+ * the modification times of the directories. A lookup only checks the times
+ * of the directories up to the one holding the command, since a later one can
+ * not shadow it, and rescans when any of them has changed.
+ */
+class Plugins
+{
+    struct Dir
+    {
+        std::string path;
+        int64_t sec, nsec;
+    };
+
+    /**
+     * @brief prefix of the executables, the program name followed by a dash
+     *
+     */
+    std::string prefix;
+
+    /**
+     * @brief the value of PATH the index was built for
+     *
+     */
+    std::string path_env;
+
+    /**
+     * @brief directories of the PATH, in order of precedence
+     *
+     */
+    std::vector<Dir> dirs;
+
+    /**
+     * @brief command names and the index of the directory they were found in
+     *
+     */
+    std::map<std::string, std::size_t> found;
+
+    bool loaded = false;
+
+    void load();
+    bool read_cache();
+    void write_cache() const;
+    void scan();
+    bool fresh(std::size_t upto) const;
+    std::string cache_file() const;
+
+    static void mtime(const std::string & dir, int64_t & sec, int64_t & nsec);
+
+public:
+    explicit Plugins(const std::string & program) : prefix(program + "-") {}
+
+    /**
+     * @brief Find the executable for the command, empty if there is none
+     *
+     * @param cmd
+     * @return std::string
+     */
+    std::string find(const std::string & cmd);
+
+    /**
+     * @brief Names of all the external commands on the PATH
+     *
+     * @return std::vector<std::string>
+     */
+    std::vector<std::string> list();
+
+    /**
+     * @brief Replace the process with the external command, args are passed as
+     * they are without a shell. Returns only by throwing on failure.
+     *
+     * @param path
+     * @param args
+     */
+    [[noreturn]] static void exec(const std::string & path,
+                                  const std::vector<std::string> & args);
+};
+
+/**
+ * @brief Read the modification time of the directory, missing directories
+ * are recorded with -1 so that their creation invalidates the index.
+ *
+ * @param dir
+ * @param sec
+ * @param nsec
+ */
+void Plugins::mtime(const std::string & dir, int64_t & sec, int64_t & nsec)
+{
+    struct stat st;
+    if (stat(dir.c_str(), &st)) { sec = nsec = -1; return; }
+
+    sec = st.st_mtim.tv_sec, nsec = st.st_mtim.tv_nsec;
+}
+
+std::string Plugins::cache_file() const
+{
+    std::string base;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        base = xdg;
+    else if (const char *home = std::getenv("HOME"); home && *home)
+        base = std::string(home) + "/.cache";
+    else return "";
+
+    return base + "/" + this->prefix.substr(0, this->prefix.size() - 1) +
+           "/plugins";
+}
+
+/**
+ * @brief Load the index from the cache, or scan the PATH if the cache is
+ * missing or was built for a different PATH.
+ *
+ */
+void Plugins::load()
+{
+    if (this->loaded) return;
+    this->loaded = true;
+
+    const char *env = std::getenv("PATH");
+    this->path_env = env ? env : "";
+    if (!this->read_cache()) this->scan();
+}
+
+/**
+ * @brief Read the cache file, the format is line based
+ *
+ *      path <PATH>
+ *      dir <sec> <nsec> <directory>
+ *      plugin <directory index> <command>
+ *
+ * @return true if the cache matches the current PATH
+ */
+bool Plugins::read_cache()
+{
+    std::ifstream in(this->cache_file());
+    std::string line;
+    if (!in || !std::getline(in, line) || line != "path " + this->path_env)
+        return false;
+
+    while (std::getline(in, line))
+    {
+        std::istringstream ss(line);
+        std::string kind, rest;
+        ss >> kind;
+
+        if (kind == "dir")
+        {
+            Dir dir;
+            ss >> dir.sec >> dir.nsec;
+            ss.get();
+            std::getline(ss, dir.path);
+            this->dirs.push_back(std::move(dir));
+        }
+        else if (kind == "plugin")
+        {
+            std::size_t idx;
+            ss >> idx;
+            ss.get();
+            std::getline(ss, rest);
+            if (!ss || idx >= this->dirs.size()) return false;
+            this->found.insert({rest, idx});
+        }
+        else return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Write the cache file atomically, failures are ignored since the
+ * index will be rebuilt on the next run.
+ *
+ */
+void Plugins::write_cache() const
+{
+    const std::string file = this->cache_file();
+    if (file.empty()) return;
+
+    // create the cache directories, the parent of the program's directory
+    // first
+    std::string dir = file.substr(0, file.rfind('/'));
+    mkdir(dir.substr(0, dir.rfind('/')).c_str(), 0755);
+    mkdir(dir.c_str(), 0755);
+
+    const std::string tmp = file + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << "path " << this->path_env << "\n";
+        for (auto & d : this->dirs)
+            out << "dir " << d.sec << " " << d.nsec << " " << d.path << "\n";
+        for (auto & p : this->found)
+            out << "plugin " << p.second << " " << p.first << "\n";
+        if (!out) { unlink(tmp.c_str()); return; }
+    }
+    if (rename(tmp.c_str(), file.c_str())) unlink(tmp.c_str());
+}
+
+/**
+ * @brief Scan the directories of the PATH for the external commands, the
+ * first directory holding a command wins.
+ *
+ */
+void Plugins::scan()
+{
+    this->dirs.clear();
+    this->found.clear();
+
+    std::stringstream ss(this->path_env);
+    for (std::string path; std::getline(ss, path, ':');)
+    {
+        if (path.empty()) continue;
+
+        Dir dir{path, 0, 0};
+        mtime(path, dir.sec, dir.nsec);
+        this->dirs.push_back(dir);
+
+        DIR *d = opendir(path.c_str());
+        if (!d) continue;
+        while (struct dirent *ent = readdir(d))
+        {
+            if (std::strncmp(ent->d_name, this->prefix.c_str(),
+                             this->prefix.size())) continue;
+
+            std::string name(ent->d_name + this->prefix.size());
+            std::string file = path + "/" + ent->d_name;
+            if (name.empty() || this->found.count(name) ||
+                access(file.c_str(), X_OK)) continue;
+
+            this->found.insert({name, this->dirs.size() - 1});
+        }
+        closedir(d);
+    }
+
+    this->write_cache();
+}
+
+/**
+ * @brief Check that directories up to the given index are unchanged
+ *
+ * @param upto
+ * @return true
+ * @return false
+ */
+bool Plugins::fresh(std::size_t upto) const
+{
+    for (std::size_t i = 0; i < this->dirs.size() && i <= upto; i++)
+    {
+        int64_t sec, nsec;
+        mtime(this->dirs[i].path, sec, nsec);
+        if (sec != this->dirs[i].sec || nsec != this->dirs[i].nsec)
+            return false;
+    }
+    return true;
+}
+
+std::string Plugins::find(const std::string & cmd)
+{
+    this->load();
+
+    auto itr = this->found.find(cmd);
+    const std::size_t upto = (itr != this->found.end()) ? itr->second
+                                                        : this->dirs.size();
+    if (!this->fresh(upto))
+    {
+        this->scan();
+        itr = this->found.find(cmd);
+    }
+
+    if (itr == this->found.end()) return "";
+    return this->dirs[itr->second].path + "/" + this->prefix + cmd;
+}
+
+std::vector<std::string> Plugins::list()
+{
+    this->load();
+    if (!this->fresh(this->dirs.size())) this->scan();
+
+    std::vector<std::string> names;
+    for (auto & el : this->found) names.push_back(el.first);
+    return names;
+}
+
+void Plugins::exec(const std::string & path,
+                   const std::vector<std::string> & args)
+{
+    std::vector<char *> argv;
+    argv.reserve(args.size() + 1);
+    for (auto & arg : args) argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    execv(path.c_str(), argv.data());
+    throw Exception(errstr::parse::EXEC_FAILED + path, std::strerror(errno));
+}
+
+} // namespace cli
+
+#endif // CLI_PLUGIN_HPP
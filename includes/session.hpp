@@ -0,0 +1,505 @@
+// -*- C++ -*-
+//===---------------------------- session.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_SESSION_HPP
+#define CLI_SESSION_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <functional>
+#include <unistd.h>
+#include <termios.h>
+#include <commander.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief Incremental parse of a command line being typed, for interactive
+ * shells. The state after every token is kept, so that an update only reproc
+ * -esses the tokens from the first one that changed, which for typing is the
+ * last one. Nothing exits the process, errors are reported in the status.
+ */
+class Session
+{
+public:
+    /**
+     * @brief Outcome of the line so far, the error is only about the tokens
+     * that are complete (followed by a space), the last one being still typed.
+     */
+    struct Status
+    {
+        std::string error;
+        std::string fix;
+        std::string hint;
+    };
+
+private:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * @brief state of the parse after a token
+     *
+     */
+    struct State
+    {
+        const Command *command = nullptr;   // selected command
+        std::size_t given = 0;              // args given to the command
+        const Option *option = nullptr;     // option taking args, if any
+        std::size_t taken = 0;              // args taken by the option
+        bool flags = false;                 // past the first flag
+        std::string error, fix;
+    };
+
+    Commander & program;
+    std::vector<std::string> tokens;
+    std::vector<State> states;
+    bool open = false;
+    bool exits;
+    Status status;
+
+    State step(const State & prev, const std::string & token, bool last);
+    void check(State & state, const std::string & key, std::string_view v,
+               bool last);
+    std::string hint(const State & state);
+    const Choices * choices(const std::string & key) const;
+
+public:
+    /**
+     * @brief Start a session, until it ends the help and the version printed
+     * by a parse of the program do not exit the process.
+     *
+     * @param p
+     */
+    explicit Session(Commander & p) : program(p), exits(p.exits)
+    {
+        this->program.exits = false;
+    }
+    ~Session() { this->program.exits = this->exits; }
+
+    Session(const Session &) = delete;
+    Session & operator=(const Session &) = delete;
+
+    /**
+     * @brief Update the session for the new content of the line, the tokens
+     * before the first changed one are not processed again.
+     *
+     * @param line
+     * @return const Status&
+     */
+    const Status & update(std::string_view line);
+
+    /**
+     * @brief Candidates to complete the token being typed, at most limit
+     *
+     * @param limit
+     * @return std::vector<std::string>
+     */
+    std::vector<std::string> complete(std::size_t limit = npos);
+
+    /**
+     * @brief Tokens of the line, to be given to Commander::parse with argv()
+     *
+     * @return const std::vector<std::string>&
+     */
+    const std::vector<std::string> & words() const noexcept { return tokens; }
+
+    /**
+     * @brief argv for Commander::parse, with the program name as argv[0], the
+     * pointers are valid until the next update.
+     *
+     * @return std::vector<char *>
+     */
+    std::vector<char *> argv();
+};
+
+const Session::Status & Session::update(std::string_view line)
+{
+    // split the line, and find the first token that changed
+    std::vector<std::string_view> split;
+    for (std::size_t i = 0; i < line.size();)
+    {
+        std::size_t start = line.find_first_not_of(' ', i);
+        if (start == line.npos) break;
+        std::size_t end = std::min(line.find(' ', start), line.size());
+        split.push_back(line.substr(start, end - start));
+        i = end;
+    }
+    const bool now_open = line.size() && line.back() != ' ';
+
+    std::size_t same = 0;
+    while (same < split.size() && same < this->tokens.size() &&
+           split[same] == this->tokens[same]) same++;
+
+    // a token being typed is not checked, the token that was or is now being
+    // typed is stepped again when it is closed or opened
+    const std::size_t was = this->open ? this->tokens.size() - 1 : npos;
+    const std::size_t now = now_open ? split.size() - 1 : npos;
+    if (was != now) same = std::min(same, std::min(was, now));
+
+    this->tokens.resize(same);
+    this->states.resize(same);
+    this->open = now_open;
+    for (std::size_t i = same; i < split.size(); i++)
+    {
+        this->tokens.emplace_back(split[i]);
+        const bool last = this->open && i + 1 == split.size();
+        this->states.push_back(this->step(i ? this->states[i - 1] : State(),
+                                          this->tokens[i], last));
+    }
+
+    const State & state = this->states.size() ? this->states.back() : State();
+    this->status.error = state.error;
+    this->status.fix = state.fix;
+    this->status.hint = this->hint(state);
+    return this->status;
+}
+
+/**
+ * @brief Check the value of an arg with its validator, if any, the value being
+ * typed is not checked yet.
+ *
+ * @param state
+ * @param key
+ * @param v
+ * @param last
+ */
+void Session::check(State & state, const std::string & key, std::string_view v,
+                    bool last)
+{
+    auto itr = this->program.validators.find(key);
+    if (last || itr == this->program.validators.end()) return;
+
+    try { itr->second.check(key, v); }
+    catch (const Exception & e) { state.error = e.what(), state.fix = e.how(); }
+}
+
+/**
+ * @brief Compute the state after the token, the token being typed (last) is
+ * not reported as unknown, it is most likely incomplete.
+ *
+ * @param prev
+ * @param token
+ * @param last
+ * @return State
+ */
+Session::State Session::step(const State & prev, const std::string & token,
+                             bool last)
+{
+    State state = prev;
+    if (state.error.length()) return state;
+
+    // a negative number is a value where one is wanted, as in the parse
+    const bool value = helper::is_number(token) && (state.flags ?
+        state.option && (state.taken < state.option->get_argv().size() ||
+                         state.option->is_variadic()) : state.command != nullptr);
+    if (helper::is_flag(token) && !value)
+    {
+        // the options of the selected command are accepted too
+        state.flags = true, state.taken = 0;
+        state.option = this->program.find_option(token, state.command);
+
+        if (!state.option && !last)
+        {
+            state.error = errstr::parse::OPTION_NOT_FOUND + token;
+            state.fix = this->program.suggest_option(token, state.command);
+        }
+        return state;
+    }
+
+    // args after the first flag belong to the option, as in the parse
+    if (state.flags)
+    {
+        if (!state.option) return state;
+
+        const Option & option = *state.option;
+        const auto & args = option.get_argv();
+        if (state.taken < args.size() || option.is_variadic())
+            this->check(state, args[std::min(state.taken, args.size() - 1)]
+                                   .first, token, last);
+        state.taken++;
+        return state;
+    }
+
+    if (!state.command)
+    {
+        auto f = this->program.find_cmd(token);
+        if (f != this->program.commands.end()) state.command = &f->first;
+        else if (!last)
+        {
+            state.error = errstr::parse::CMD_NOT_FOUND;
+            state.fix = this->program.suggest_cmd(token);
+        }
+        return state;
+    }
+
+    // a subcommand is named by the arg following its parent
+    const std::string & name = state.command->getName();
+    if (!state.given && this->program.has_subcommands(name))
+    {
+        auto f = this->program.find_cmd(name + " " + token);
+        if (f != this->program.commands.end())
+        {
+            state.command = &f->first;
+            return state;
+        }
+    }
+
+    const auto & keys = state.command->getargv();
+    if (state.given < keys.size() || (keys.size() &&
+                                      state.command->isVariadic()))
+        this->check(state, keys[std::min(state.given, keys.size() - 1)], token,
+                    last);
+    state.given++;
+    return state;
+}
+
+/**
+ * @brief Hint for what is expected next, the args still missing
+ *
+ * @param state
+ * @return std::string
+ */
+std::string Session::hint(const State & state)
+{
+    std::string hint;
+    if (this->open && this->tokens.size())
+    {
+        // inline completion of the token being typed
+        auto candidates = this->complete(2);
+        if (candidates.size() == 1)
+            return candidates.front().substr(this->tokens.back().size());
+    }
+
+    if (state.option)
+    {
+        const Option & option = *state.option;
+        const auto & args = option.get_argv();
+        for (std::size_t i = state.taken; i < args.size(); i++)
+            hint += (int(i) < option.get_required())
+                        ? " <" + args[i].first + ">" : " [" + args[i].first + "]";
+        return hint;
+    }
+
+    if (state.command && !state.flags)
+    {
+        const auto & keys = state.command->getargv();
+        for (std::size_t i = state.given; i < keys.size(); i++)
+            hint += (int(i) < state.command->getRequired())
+                        ? " <" + keys[i] + ">" : " [" + keys[i] + "]";
+    }
+    return hint;
+}
+
+std::vector<std::string> Session::complete(std::size_t limit)
+{
+    std::vector<std::string> candidates;
+    const std::string prefix = this->open ? this->tokens.back() : "";
+    const std::size_t at = this->open ? this->tokens.size() - 1
+                                      : this->tokens.size();
+    const State state = at ? this->states[at - 1] : State();
+
+    auto add = [&](const std::string & c) {
+        if (candidates.size() < limit && !c.compare(0, prefix.size(), prefix)) 
+            candidates.push_back(c);
+    };
+
+    // values of an arg restricted to choices
+    const Choices *values = nullptr;
+    if (state.option)
+    {
+        const Option & option = *state.option;
+        const auto & args = option.get_argv();
+        if (args.size() && (state.taken < args.size() || option.is_variadic()))
+            values = this->choices(args[std::min(state.taken, 
+                                                 args.size() - 1)].first);
+    }
+    else if (state.command && !state.flags && (state.given || 
+             !this->program.has_subcommands(state.command->getName())))
+    {
+        // the first arg of a command with subcommands names one of them
+        const auto & keys = state.command->getargv();
+        if (keys.size() && (state.given < keys.size() || 
+                            state.command->isVariadic()))
+            values = this->choices(keys[std::min(state.given, keys.size() - 1)]);
+    }
+    if (values && !helper::is_flag(prefix))
+    {
+        for (auto & el : values->all()) add(el);
+        return candidates;
+    }
+
+    if (helper::is_flag(prefix) || state.flags)
+    {
+        this->program.each_option(state.command, [&](const Option & el) {
+            add(el.get_flag());
+            if (el.get_secondary_flag().length()) add(el.get_secondary_flag());
+        });
+        return candidates;
+    }
+
+    // commands, or the subcommands of the selected command, are completed
+    // by their last word
+    std::string scope;
+    if (state.command)
+    {
+        if (state.given) return candidates;
+        scope = state.command->getName() + " ";
+    }
+
+    // both maps are ordered by name, only the names with the prefix are seen
+    const std::string start = scope + prefix;
+    auto word = [&](const std::string & name) {
+        if (name.compare(0, start.size(), start)) return false;
+        if (name.find(' ', scope.size()) == name.npos) 
+            add(name.substr(scope.size()));
+        return candidates.size() < limit;
+    };
+    for (auto itr = this->program.commands.lower_bound(start); 
+         itr != this->program.commands.end() && word(itr->first.getName());) 
+        itr++;
+    for (auto itr = this->program.lazy.lower_bound(start); 
+         itr != this->program.lazy.end() && word(itr->first);) 
+        itr++;
+    return candidates;
+}
+
+/**
+ * @brief Choices of an arg, null if its values are not restricted to choices
+ *
+ * @param key
+ * @return const Choices*
+ */
+const Choices * Session::choices(const std::string & key) const
+{
+    auto itr = this->program.validators.find(key);
+    return itr != this->program.validators.end() ? itr->second.get_choices()
+                                                 : nullptr;
+}
+
+std::vector<char *> Session::argv()
+{
+    std::vector<char *> argv{const_cast<char *>(this->program.name.c_str())};
+    for (auto & token : this->tokens) argv.push_back(token.data());
+    return argv;
+}
+
+/**
+ * @brief Interactive loop with line editing, live validation, hints and Tab
+ * completion. Every entered line is given to the callback through the session
+ * (Session::argv() is ready for Commander::parse). Returns on Ctrl-D or EOF.
+ * Without a terminal the lines are read as they are.
+ *
+ * @param program
+ * @param prompt
+ * @param on_line
+ */
+void repl(Commander & program, const std::string & prompt,
+          const std::function<void(Session &)> & on_line)
+{
+    Session session(program);
+
+    if (!isatty(STDIN_FILENO))
+    {
+        for (std::string line; std::getline(std::cin, line);)
+        {
+            session.update(line + " ");
+            if (session.words().size()) on_line(session);
+        }
+        return;
+    }
+
+    // raw mode, restored when the loop ends
+    struct termios cooked, raw;
+    tcgetattr(STDIN_FILENO, &cooked);
+    raw = cooked;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+    raw.c_cc[VMIN] = 1, raw.c_cc[VTIME] = 0;
+    struct Restore
+    {
+        struct termios & t;
+        ~Restore() { tcsetattr(STDIN_FILENO, TCSAFLUSH, &t); }
+    } restore{cooked};
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+    std::string line;
+    std::size_t cursor = 0;
+
+    auto render = [&](const Session::Status & status) {
+        std::string out = "\r" + _P(prompt) + line;
+        if (status.error.length())
+            out += "  " + std::string(RED) + status.error +
+                   (status.fix.length() ? " " + status.fix : "") + RESET;
+        else if (status.hint.length())
+            out += std::string("\033[2m") + status.hint + RESET;
+        out += "\033[K\r\033[" + std::to_string(prompt.size() + cursor) + "C";
+        if (prompt.size() + cursor == 0) out.erase(out.size() - 4);
+        std::cout << out << std::flush;
+    };
+
+    render(session.update(line));
+    for (char c; read(STDIN_FILENO, &c, 1) == 1;)
+    {
+        if (c == 4 && line.empty()) break;                      // Ctrl-D
+        else if (c == 3) line.clear(), cursor = 0;              // Ctrl-C
+        else if (c == '\r' || c == '\n')
+        {
+            session.update(line + " ");
+            std::cout << "\r" << _P(prompt) << line << "\033[K\n" << std::flush;
+
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &cooked);
+            if (session.words().size()) on_line(session);
+            tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+            line.clear(), cursor = 0;
+        }
+        else if ((c == 127 || c == 8) && cursor)                // Backspace
+            line.erase(--cursor, 1);
+        else if (c == 1) cursor = 0;                            // Ctrl-A
+        else if (c == 5) cursor = line.size();                  // Ctrl-E
+        else if (c == 21) line.erase(0, cursor), cursor = 0;    // Ctrl-U
+        else if (c == '\t' && cursor == line.size())
+        {
+            auto candidates = session.complete();
+            if (candidates.size() == 1)
+            {
+                const std::size_t typed = (line.size() && line.back() != ' ')
+                        ? line.size() - line.find_last_of(' ') - 1 : 0;
+                line += candidates.front().substr(std::min(typed,
+                                                candidates.front().size())) + " ";
+                cursor = line.size();
+            }
+            else if (candidates.size() > 1)
+            {
+                std::cout << "\r\n";
+                for (auto & el : candidates) std::cout << el << "  ";
+                std::cout << "\r\n";
+            }
+        }
+        else if (c == 27)                                       // arrows
+        {
+            char seq[2];
+            if (read(STDIN_FILENO, seq, 2) != 2 || seq[0] != '[') continue;
+            if (seq[1] == 'C' && cursor < line.size()) cursor++;
+            if (seq[1] == 'D' && cursor) cursor--;
+        }
+        else if (c >= 32 && c < 127) line.insert(cursor++, 1, c);
+
+        render(session.update(line));
+    }
+    std::cout << "\n";
+}
+
+} // namespace cli
+
+#endif // CLI_SESSION_HPP
@@ -0,0 +1,97 @@
+// -*- C++ -*-
+//===----------------------------- stream.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_STREAM_HPP
+#define CLI_STREAM_HPP
+
+#include <string_view>
+#include <functional>
+#include <iterator>
+
+namespace cli
+{
+
+/**
+ * @brief Pull based range over the args of a command, read straight from argv
+ * when the iteration reaches them. Each arg is checked once, when the iterat
+ * -ion reaches it, so that a program can start working on the first arg while
+ * the rest are not even looked at.
+ */
+class Positionals
+{
+public:
+    /**
+     * @brief check run on an arg before it is yielded, given its index among
+     * the args of the command, throws cli::Exception if the arg is invalid.
+     */
+    using Check = std::function<void(std::size_t, std::string_view)>;
+
+private:
+    char **first = nullptr, **last = nullptr;
+    Check check;
+
+public:
+    class iterator
+    {
+        const Positionals *range;
+        char **arg;
+        std::string_view value;
+
+        /**
+         * @brief Read and check the arg reached, dereferencing it is then free
+         *
+         */
+        void reach()
+        {
+            if (this->arg == this->range->last) return;
+
+            this->value = *this->arg;
+            if (this->range->check)
+                this->range->check(this->arg - this->range->first, this->value);
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        iterator(const Positionals *r, char **a) : range(r), arg(a)
+        {
+            this->reach();
+        }
+
+        std::string_view operator*() const noexcept { return this->value; }
+        iterator & operator++() { this->arg++, this->reach(); return *this; }
+        bool operator==(const iterator & i) const { return arg == i.arg; }
+        bool operator!=(const iterator & i) const { return arg != i.arg; }
+    };
+
+    Positionals() = default;
+    Positionals(char **f, char **l, Check c = nullptr)
+        : first(f), last(l), check(std::move(c)) {}
+
+    /**
+     * @brief Number of args, known without reading them
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return this->last - this->first; }
+    bool empty() const noexcept { return this->first == this->last; }
+
+    iterator begin() const { return iterator(this, this->first); }
+    iterator end() const noexcept { return iterator(this, this->last); }
+};
+
+} // namespace cli
+
+#endif // CLI_STREAM_HPP
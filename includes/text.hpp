@@ -0,0 +1,238 @@
+// -*- C++ -*-
+//===------------------------------ text.hpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_TEXT_HPP
+#define CLI_TEXT_HPP
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace cli
+{
+
+/**
+ * @brief Catalog of help texts kept out of the spec, in an external help file
+ * or in a blob embedded in the binary. Nothing is read until the first lookup,
+ * which maps the file and indexes it, so runs that never render help or error
+ * text never touch it.
+ *
+ * The format is one entry per line, the key and the text separated by a tab,
+ * lines starting with '#' are ignored.
+ *
+ *      commit.message	provide a message to the commit
+ */
+class Catalog
+{
+    /**
+     * @brief path of the help file, empty if the catalog is a blob
+     *
+     */
+    std::string path;
+
+    /**
+     * @brief contents of the catalog, either mapped from the file or pointing
+     * to the embedded blob.
+     */
+    mutable const char *data = nullptr;
+    mutable std::size_t size = 0;
+    mutable bool mapped = false;
+
+    /**
+     * @brief index from the keys to their texts, built on the first lookup
+     *
+     */
+    mutable std::unordered_map<std::string_view, std::string_view> index;
+    mutable std::once_flag loaded;
+
+    void load() const;
+
+public:
+    Catalog() = default;
+    Catalog(const Catalog &) = delete;
+    Catalog & operator=(const Catalog &) = delete;
+    ~Catalog();
+
+    /**
+     * @brief Use the help file at the path, the file is mapped lazily
+     *
+     * @param file
+     */
+    void open(const std::string & file) { this->path = file; }
+
+    /**
+     * @brief Use a blob embedded in the binary, the blob must outlive the cat
+     * -alog. Being read only data it is paged in only on the first lookup.
+     *
+     * @param blob
+     * @param length
+     */
+    void assign(const char *blob, std::size_t length) noexcept
+    {
+        this->data = blob, this->size = length;
+    }
+
+    /**
+     * @brief Find the text for the key, empty if the key is not present
+     *
+     * @param key
+     * @return std::string_view
+     */
+    std::string_view lookup(std::string_view key) const;
+};
+
+/**
+ * @brief Description of an option or a command. It either holds the text or
+ * the key of an entry in a Catalog, which is resolved only when rendered. A
+ * cold text shares the catalog of its commander, a plain text costs no more
+ * than its string and an empty pointer.
+ */
+class Text
+{
+    /**
+     * @brief the text itself, or the key if the text is cold
+     *
+     */
+    std::string value;
+
+    /**
+     * @brief catalog that resolves the key, null for a plain text. A cold text
+     * holds the empty catalog until it is bound.
+     */
+    std::shared_ptr<const Catalog> catalog;
+
+    static const std::shared_ptr<const Catalog> & unbound()
+    {
+        static const std::shared_ptr<const Catalog> empty = 
+            std::make_shared<Catalog>();
+        return empty;
+    }
+
+public:
+    Text() = default;
+    Text(const std::string & str) : value(str) {}
+    Text(const char *str) : value(str) {}
+
+    /**
+     * @brief Build a text that is resolved from the catalog by the key
+     *
+     * @param key
+     * @return Text
+     */
+    static Text from(const std::string & key)
+    {
+        Text text(key);
+        text.catalog = unbound();
+        return text;
+    }
+
+    /**
+     * @brief Bind a cold text to the catalog of the commander
+     *
+     * @param c
+     */
+    void bind(const std::shared_ptr<const Catalog> & c) noexcept
+    {
+        if (c && this->catalog == unbound()) this->catalog = c;
+    }
+
+    /**
+     * @brief Resolve the text, an unresolved key is rendered as it is
+     *
+     * @return std::string_view
+     */
+    std::string_view str() const
+    {
+        if (!this->catalog) return this->value;
+
+        std::string_view text = this->catalog->lookup(this->value);
+        return text.size() ? text : std::string_view(this->value);
+    }
+
+    friend std::ostream& operator<<(std::ostream & os, const Text & text)
+    {
+        return os << text.str();
+    }
+};
+
+/**
+ * @brief Description resolved from the help catalog by the key, for example
+ * program.option("-m <message>", cli::cold("commit.message"));
+ *
+ * @param key
+ * @return Text
+ */
+Text cold(const std::string & key)
+{
+    return Text::from(key);
+}
+
+Catalog::~Catalog()
+{
+    if (this->mapped) munmap(const_cast<char *>(this->data), this->size);
+}
+
+/**
+ * @brief Map the help file if any and index the entries
+ *
+ */
+void Catalog::load() const
+{
+    if (this->path.length())
+    {
+        int fd = ::open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0) return;
+
+        if (!fstat(fd, &st) && st.st_size > 0)
+        {
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, 
+                              fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                this->data = static_cast<const char *>(addr);
+                this->size = st.st_size, this->mapped = true;
+            }
+        }
+        close(fd);
+    }
+
+    std::string_view contents(this->data ? this->data : "", this->size);
+    while (contents.size())
+    {
+        std::size_t eol = contents.find('\n');
+        std::string_view line = contents.substr(0, eol);
+        contents.remove_prefix(eol == contents.npos ? contents.size() : eol + 1);
+
+        std::size_t tab = line.find('\t');
+        if (line.empty() || line.front() == '#' || tab == line.npos) continue;
+        this->index.insert({line.substr(0, tab), line.substr(tab + 1)});
+    }
+}
+
+std::string_view Catalog::lookup(std::string_view key) const
+{
+    std::call_once(this->loaded, [this] { this->load(); });
+
+    auto itr = this->index.find(key);
+    return itr != this->index.end() ? itr->second : std::string_view();
+}
+
+} // namespace cli
+
+#endif // CLI_TEXT_HPP
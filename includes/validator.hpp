@@ -0,0 +1,299 @@
+// -*- C++ -*-
+//===--------------------------- validator.hpp ----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_VALIDATOR_HPP
+#define CLI_VALIDATOR_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <regex>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <charconv>
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
+#include <exception.hpp>
+#include <helper.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief Set of strings with a perfect hash, built once at registration. Keys
+ * are spread in buckets by a first hash, then every bucket, largest first, is
+ * given a displacement that places all its keys in free slots of the table,
+ * so a lookup is two hashes and a single comparison whatever the set's size.
+ * If no displacement is found for a bucket, as for two keys of the same hash,
+ * the set falls back to a binary search of its sorted keys.
+ */
+class Choices
+{
+    /**
+     * @brief the distinct choices, in the order they were given
+     *
+     */
+    std::vector<std::string> keys;
+
+    /**
+     * @brief displacement of every bucket
+     *
+     */
+    std::vector<uint32_t> displacement;
+
+    /**
+     * @brief index of the key in every slot, empty slots hold npos
+     *
+     */
+    std::vector<uint32_t> slots;
+
+    /**
+     * @brief index of the keys in their sorted order, only used when no perfect
+     * hash was found
+     *
+     */
+    std::vector<uint32_t> sorted;
+
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t tries = 1 << 16;
+
+    static uint64_t hash(std::string_view key) noexcept;
+    static uint64_t mix(uint64_t h, uint64_t seed) noexcept;
+
+public:
+    explicit Choices(const std::vector<std::string> & choices);
+
+    /**
+     * @brief Check if the value is one of the choices
+     *
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool contains(std::string_view value) const noexcept;
+
+    /**
+     * @brief the choices, used for the error hints
+     *
+     * @return const std::vector<std::string>&
+     */
+    const std::vector<std::string> & all() const noexcept { return keys; }
+};
+
+/**
+ * @brief Declarative check of the values of an arg, its choices, its numeric
+ * range and its pattern, compiled when registered and run in the parse.
+ */
+class Validator
+{
+    std::unique_ptr<Choices> choices;
+    std::unique_ptr<std::regex> regex;
+    std::string pattern;
+    double min = 0, max = 0;
+    bool ranged = false;
+
+public:
+    void set_choices(const std::vector<std::string> & c)
+    {
+        this->choices = std::make_unique<Choices>(c);
+    }
+
+    void set_range(double lo, double hi) noexcept
+    {
+        this->min = lo, this->max = hi, this->ranged = true;
+    }
+
+    void set_pattern(const std::string & p)
+    {
+        this->regex = std::make_unique<std::regex>(p, std::regex::optimize);
+        this->pattern = p;
+    }
+
+    /**
+     * @brief Choices of the arg, null if not restricted to choices
+     *
+     * @return const Choices*
+     */
+    const Choices * get_choices() const noexcept { return choices.get(); }
+
+    /**
+     * @brief Check the value of the arg
+     *
+     * @param key
+     * @param value
+     * @throw cli::Exception with the offending value
+     */
+    void check(std::string_view key, std::string_view value) const;
+};
+
+/**
+ * @brief FNV-1a hash of the key, the base of both hashes of the set
+ *
+ * @param key
+ * @return uint64_t
+ */
+uint64_t Choices::hash(std::string_view key) noexcept
+{
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : key) h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+/**
+ * @brief Derive a new hash from the base hash and a seed (splitmix64)
+ *
+ * @param h
+ * @param seed
+ * @return uint64_t
+ */
+uint64_t Choices::mix(uint64_t h, uint64_t seed) noexcept
+{
+    h ^= (seed + 1) * 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+Choices::Choices(const std::vector<std::string> & choices)
+{
+    std::unordered_set<std::string_view> seen;
+    this->keys.reserve(choices.size());
+    for (auto & c : choices) if (seen.insert(c).second) this->keys.push_back(c);
+
+    const std::size_t n = this->keys.size();
+    const std::size_t buckets = n / 4 + 1;
+    const std::size_t m = n + n / 4 + 1;
+
+    std::vector<uint64_t> hashes(n);
+    std::vector<std::vector<uint32_t>> bucket(buckets);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        hashes[i] = hash(this->keys[i]);
+        bucket[hashes[i] % buckets].push_back(i);
+    }
+
+    std::vector<uint32_t> order(buckets);
+    for (uint32_t i = 0; i < buckets; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return bucket[a].size() > bucket[b].size();
+    });
+
+    this->displacement.assign(buckets, 0);
+    this->slots.assign(m, npos);
+    std::vector<std::size_t> taken;
+    for (uint32_t b : order)
+    {
+        if (bucket[b].empty()) break;
+
+        // try displacements until every key of the bucket lands in a free slot
+        uint32_t d = 0;
+        for (; d < tries; d++)
+        {
+            taken.clear();
+            for (uint32_t k : bucket[b])
+            {
+                std::size_t slot = mix(hashes[k], d) % m;
+                if (this->slots[slot] != npos || std::find(taken.begin(),
+                        taken.end(), slot) != taken.end()) break;
+                taken.push_back(slot);
+            }
+            if (taken.size() < bucket[b].size()) continue;
+
+            for (std::size_t i = 0; i < taken.size(); i++)
+                this->slots[taken[i]] = bucket[b][i];
+            this->displacement[b] = d;
+            break;
+        }
+
+        // keys of the same hash never land apart, search the sorted keys
+        if (d == tries)
+        {
+            this->displacement.clear();
+            this->slots.clear();
+            this->sorted.resize(n);
+            for (uint32_t i = 0; i < n; i++) this->sorted[i] = i;
+            std::sort(this->sorted.begin(), this->sorted.end(), 
+                      [&](uint32_t a, uint32_t b) {
+                return this->keys[a] < this->keys[b];
+            });
+            return;
+        }
+    }
+}
+
+bool Choices::contains(std::string_view value) const noexcept
+{
+    if (this->keys.empty()) return false;
+
+    if (this->displacement.empty())
+    {
+        auto it = std::lower_bound(this->sorted.begin(), this->sorted.end(),
+                                   value, [&](uint32_t k, std::string_view v) {
+            return this->keys[k] < v;
+        });
+        return it != this->sorted.end() && this->keys[*it] == value;
+    }
+
+    const uint64_t h = hash(value);
+    const uint32_t d = this->displacement[h % this->displacement.size()];
+    const uint32_t k = this->slots[mix(h, d) % this->slots.size()];
+
+    return k != npos && this->keys[k] == value;
+}
+
+void Validator::check(std::string_view key, std::string_view value) const
+{
+    // the error is only built on failure, checks of valid values are free of
+    // allocations
+    auto what = [&] {
+        return errstr::parse::INVALID_VALUE + "'" + std::string(value) + 
+               "' for " + std::string(key);
+    };
+
+    if (this->choices && !this->choices->contains(value))
+    {
+        const auto & all = this->choices->all();
+        std::vector<std::string_view> candidates(all.begin(), all.end());
+        std::string fix = helper::did_you_mean(value, candidates);
+        if (fix.empty() && all.size() <= 8)
+        {
+            fix = "Expected one of";
+            for (auto & c : all) fix += " '" + c + "'";
+        }
+        throw Exception(what(), fix);
+    }
+
+    if (this->ranged)
+    {
+        double number = 0;
+        auto res = std::from_chars(value.data(), value.data() + value.size(),
+                                   number);
+        // written so that nan is out of every range
+        if (res.ec != std::errc() || res.ptr != value.data() + value.size() ||
+            !(this->min <= number && number <= this->max))
+        {
+            std::ostringstream fix;
+            fix << "Expected a number between " << this->min << " and " 
+                << this->max;
+            throw Exception(what(), fix.str());
+        }
+    }
+
+    if (this->regex &&
+        !std::regex_match(value.begin(), value.end(), *this->regex))
+        throw Exception(what(), "Expected to match " + this->pattern);
+}
+
+} // namespace cli
+
+#endif // CLI_VALIDATOR_HPP
@@ -0,0 +1,126 @@
+// -*- C++ -*-
+//===----------------------------- values.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLI_VALUES_HPP
+#define CLI_VALUES_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+
+namespace cli
+{
+
+/**
+ * @brief All the values given for one key, by a repeated option or a variadic
+ * argument. The values are stored back to back in a single buffer, each one
+ * terminated by '\0', and located by their offsets, so that the count and any
+ * value are O(1) and 50,000 values cost two allocations instead of 50,000.
+ */
+class Values
+{
+    /**
+     * @brief the values, each followed by a '\0'
+     *
+     */
+    std::string buffer;
+
+    /**
+     * @brief offset of every value in the buffer
+     *
+     */
+    std::vector<uint32_t> offsets;
+
+public:
+    class iterator
+    {
+        const Values *values;
+        std::size_t idx;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        iterator(const Values *v, std::size_t i) : values(v), idx(i) {}
+
+        std::string_view operator*() const { return (*this->values)[idx]; }
+        iterator & operator++() { this->idx++; return *this; }
+        iterator operator++(int) { iterator i = *this; this->idx++; return i; }
+        bool operator==(const iterator & i) const { return idx == i.idx; }
+        bool operator!=(const iterator & i) const { return idx != i.idx; }
+    };
+
+    /**
+     * @brief Reserve the storage for the count of values of the total length
+     *
+     * @param count
+     * @param length
+     */
+    void reserve(std::size_t count, std::size_t length)
+    {
+        this->offsets.reserve(this->offsets.size() + count);
+        this->buffer.reserve(this->buffer.size() + length + count);
+    }
+
+    /**
+     * @brief Append a value
+     *
+     * @param value
+     */
+    void push(std::string_view value)
+    {
+        this->offsets.push_back(static_cast<uint32_t>(this->buffer.size()));
+        this->buffer.append(value.data(), value.size());
+        this->buffer.push_back('\0');
+    }
+
+    void clear() noexcept { this->buffer.clear(), this->offsets.clear(); }
+
+    std::size_t size() const noexcept { return this->offsets.size(); }
+    bool empty() const noexcept { return this->offsets.empty(); }
+
+    /**
+     * @brief Get the value at the index, also null terminated
+     *
+     * @param i
+     * @return std::string_view
+     */
+    std::string_view operator[](std::size_t i) const noexcept
+    {
+        const std::size_t end = (i + 1 < this->offsets.size())
+                                    ? this->offsets[i + 1] : this->buffer.size();
+        return std::string_view(this->buffer.data() + this->offsets[i],
+                                end - this->offsets[i] - 1);
+    }
+
+    /**
+     * @brief Memory held by the values
+     *
+     * @return std::size_t
+     */
+    std::size_t capacity() const noexcept
+    {
+        return this->buffer.capacity() +
+               this->offsets.capacity() * sizeof(uint32_t);
+    }
+
+    iterator begin() const noexcept { return iterator(this, 0); }
+    iterator end() const noexcept { return iterator(this, this->size()); }
+};
+
+} // namespace cli
+
+#endif // CLI_VALUES_HPP
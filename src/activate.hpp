@@ -0,0 +1,454 @@
+// -*- C++ -*-
+//===----------------------------- activate.hpp ---------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_ACTIVATE_HPP
+#define DOTFILES_ACTIVATE_HPP
+
+#include <set>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <climits>
+#include <fstream>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <exception.hpp>
+#include "store.hpp"
+#include "uring.hpp"
+#include "pool.hpp"
+
+namespace dotfiles
+{
+
+/**
+ * @brief Counts of an activation
+ */
+struct Activation
+{
+    std::string commit;
+    std::size_t linked = 0, unlinked = 0, replaced = 0, farmed = 0;
+    bool uring = false;
+};
+
+/**
+ * @brief Farm of the active commit. Every commit gets a farm, a tree of
+ * copies of its objects under <root>/farms/<commit>, and <root>/active links
+ * to the farm of the active commit. A tracked file in the home directory is a
+ * link to its path under <root>/active, which does not depend on the commit,
+ * so activating another commit is a single rename of <root>/active and only
+ * the files added or removed between the two commits need their home link to
+ * be created or removed. The farm of the previous commit is kept, switching
+ * back to it copies only the files edited since, and older farms are recycled
+ * into the farms of new commits.
+ *
+ * The copies have the mode of the tracked files, and are clones sharing the
+ * blocks of their object where the file system supports it, or are written
+ * out of the chunks of a chunked file. Writing through a home link changes
+ * the copy and never the store, and an edited copy is copied again.
+ *
+ * Links for the added files are created before the switch, they dangle until
+ * it and so look absent like in the old commit. Links for the removed files
+ * are removed after it, they dangle from it and look absent like in the new
+ * commit. A file replaced by a link becomes one when the link resolves to its
+ * content, before the switch for the content of the old commit and after it
+ * for the content of the new one. The home directory is never seen half way
+ * between two commits.
+ */
+class Farm
+{
+    const Store & store;
+    Pool & pool;
+
+    fs::path farm(std::string_view commit) const
+    {
+        return this->store.get_root() / "farms" / commit;
+    }
+
+    fs::path link(std::string_view path) const
+    {
+        return this->store.get_root() / "active" / path;
+    }
+
+    /**
+     * @brief Home files whose replacement by a link is staged for the farm of
+     * the commit, one per line
+     */
+    fs::path journal(std::string_view commit) const
+    {
+        return this->farm(std::string(commit) + ".replace");
+    }
+
+    std::size_t build(const std::string & commit, const Tree & tree,
+                      const std::string & current, Links & links) const;
+    void recover(const std::string & current, Links & links) const;
+    static std::string target(const fs::path & path);
+    static bool untouched(const struct stat & st, const Entry & entry);
+    static bool same(const struct stat & st, const Entry & entry);
+
+public:
+    Farm(const Store & s, Pool & p) : store(s), pool(p) {}
+
+    /**
+     * @brief Active commit, empty before the first activation
+     *
+     * @return std::string
+     */
+    std::string active() const;
+
+    /**
+     * @brief Make the commit the active one
+     *
+     * @param name the commit, as accepted by Store::resolve
+     * @return Activation
+     * @throw cli::Exception if a home file not managed by the store would be
+     * replaced, or a file edited through its link and not added since would
+     * be lost, nothing is changed then
+     */
+    Activation activate(std::string_view name) const;
+};
+
+/**
+ * @brief Target of the link, empty if the path is not a link
+ *
+ * @param path
+ * @return std::string
+ */
+std::string Farm::target(const fs::path & path)
+{
+    char buffer[PATH_MAX];
+    ssize_t n = readlink(path.c_str(), buffer, sizeof buffer);
+    return n < 0 ? std::string() : std::string(buffer, n);
+}
+
+/**
+ * @brief Whether the file is the one the index entry was recorded from
+ *
+ * @param st
+ * @param entry
+ * @return true
+ * @return false
+ */
+bool Farm::same(const struct stat & st, const Entry & entry)
+{
+    return entry.ino == st.st_ino && entry.size == uint64_t(st.st_size) &&
+           entry.mtime == int64_t(st.st_mtim.tv_sec) * 1000000000 +
+                          st.st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Whether the file of the farm is the copy of the entry as it was
+ * made. A copy is given an mtime older than its ctime, while a write sets both
+ * to the same time, as does the creation of a file replacing the copy.
+ *
+ * @param st
+ * @param entry
+ * @return true
+ * @return false
+ */
+bool Farm::untouched(const struct stat & st, const Entry & entry)
+{
+    return S_ISREG(st.st_mode) && (st.st_mode & 07777) == (entry.mode & 07777) &&
+           (st.st_mtim.tv_sec < st.st_ctim.tv_sec ||
+            (st.st_mtim.tv_sec == st.st_ctim.tv_sec &&
+             st.st_mtim.tv_nsec < st.st_ctim.tv_nsec));
+}
+
+std::string Farm::active() const
+{
+    // the active link is relative, "farms/<commit>"
+    const std::string to = target(this->store.get_root() / "active");
+    const std::size_t slash = to.rfind('/');
+    return slash == std::string::npos ? std::string() : to.substr(slash + 1);
+}
+
+/**
+ * @brief Build the farm of the commit. A farm built before is checked for the
+ * copies edited since, otherwise the farm of a commit that is no longer active
+ * is recycled when there is one. Only the copies of the files that differ
+ * between the two commits, or that were edited, are made again, and the farm
+ * is built in a temporary directory renamed once complete.
+ *
+ * @param commit
+ * @param tree
+ * @param current the active commit, whose farm is left alone
+ * @param links
+ * @return std::size_t copies made
+ */
+std::size_t Farm::build(const std::string & commit, const Tree & tree,
+                        const std::string & current, Links & links) const
+{
+    const fs::path done = this->farm(commit);
+    if (commit == current && fs::exists(done)) return 0;
+
+    const fs::path tmp = this->farm(commit + ".tmp");
+    fs::remove_all(tmp);
+    fs::create_directories(tmp.parent_path());
+
+    std::string spare = fs::exists(done) ? commit : std::string();
+    for (auto & entry : fs::directory_iterator(tmp.parent_path()))
+    {
+        const std::string name = entry.path().filename().string();
+        if (spare.empty() && name.size() == 64 && name != current) spare = name;
+    }
+
+    Tree old;
+    if (spare.size())
+    {
+        old = spare == commit ? tree : this->store.tree(spare);
+        fs::rename(this->farm(spare), tmp);
+    }
+    else fs::create_directories(tmp);
+
+    // files of the recycled farm that are gone
+    for (auto & [path, entry] : old)
+        if (!tree.count(path)) links.unlink((tmp / path).string());
+    links.flush();
+
+    // every directory of the tree, the sorted set gives parents before children
+    std::set<std::string, std::less<>> dirs;
+    for (auto & [path, entry] : tree)
+        for (std::size_t s = path.find('/'); s != std::string::npos;
+             s = path.find('/', s + 1))
+            dirs.insert(path.substr(0, s));
+    for (auto & dir : dirs)
+        if (mkdir((tmp / dir).c_str(), 0755) && errno != EEXIST)
+            throw cli::Exception("Cannot create " + (tmp / dir).string() +
+                                 ": " + strerror(errno));
+
+    // a file of the recycled farm is kept if it is the untouched copy of the
+    // same object, and copied again otherwise, on the pool. The copies are
+    // dated a second back, older than their ctime even on a coarse clock
+    struct timespec stamp;
+    clock_gettime(CLOCK_REALTIME, &stamp);
+    stamp.tv_sec -= 1;
+    const struct timespec times[2] = {{0, UTIME_OMIT}, stamp};
+
+    std::vector<const Tree::value_type *> files;
+    for (auto & file : tree) files.push_back(&file);
+
+    std::atomic<std::size_t> count{0};
+    for (std::size_t first = 0; first < files.size(); first += 64)
+        this->pool.submit([&, first] {
+            const std::size_t last = std::min(first + 64, files.size());
+            for (std::size_t i = first; i < last; i++)
+            {
+                auto & [path, entry] = *files[i];
+                const fs::path to = tmp / path;
+                auto was = old.find(path);
+
+                struct stat st;
+                if (was != old.end() && was->second.hash == entry.hash &&
+                    !lstat(to.c_str(), &st) && untouched(st, entry))
+                    continue;
+
+                if (was != old.end() && unlink(to.c_str()) && errno != ENOENT)
+                    throw cli::Exception("Cannot remove " + to.string() + ": " +
+                                         strerror(errno));
+                this->store.checkout(entry, to);
+                if (utimensat(AT_FDCWD, to.c_str(), times, 0))
+                    throw cli::Exception("Cannot date " + to.string() + ": " +
+                                         strerror(errno));
+                count++;
+            }
+        });
+    this->pool.wait();
+
+    fs::rename(tmp, done);
+    return count;
+}
+
+/**
+ * @brief Settle the activations cut short. The replacements staged for the
+ * active farm are finished, the ones staged for another farm are dropped as
+ * its switch never happened.
+ *
+ * @param current the active commit
+ * @param links
+ */
+void Farm::recover(const std::string & current, Links & links) const
+{
+    std::vector<fs::path> journals;
+    std::error_code ec;
+    for (auto & entry : fs::directory_iterator(this->store.get_root() / "farms",
+                                               ec))
+        if (entry.path().extension() == ".replace")
+            journals.push_back(entry.path());
+
+    for (auto & journal : journals)
+    {
+        std::ifstream in(journal);
+        const bool switched = journal.stem() == current;
+        for (std::string file; std::getline(in, file);)
+        {
+            struct stat st;
+            const std::string staged = file + ".dotfiles-new";
+            if (!switched) links.unlink(staged);
+            else if (!lstat(staged.c_str(), &st)) links.rename(staged, file);
+        }
+        links.flush();
+        fs::remove(journal);
+    }
+}
+
+Activation Farm::activate(std::string_view name) const
+{
+    Activation result;
+    result.commit = this->store.resolve(name);
+
+    // the index is updated at the end, and two activations never interleave
+    const Lock guard = this->store.lock();
+    const Tree next = this->store.tree(result.commit);
+    const std::string current = this->active();
+    const Tree prev = current.size() ? this->store.tree(current) : Tree();
+
+    Links links(this->pool);
+    result.uring = links.uring();
+    this->recover(current, links);
+    result.farmed = this->build(result.commit, next, current, links);
+
+    // plan the home links from the diff of the two trees, before any change
+    Index index = this->store.load();
+    const fs::path & home = this->store.get_home();
+    std::vector<std::pair<std::string, std::string>> create, early, late;
+    std::vector<std::string> remove, conflicts;
+    std::set<fs::path> parents;
+
+    for (auto & [path, entry] : next)
+    {
+        // a path of both commits is a link already, unless it was replaced
+        // by a file since, the link is checked when the content changes
+        auto was = prev.find(path);
+        if (was != prev.end() && was->second.hash == entry.hash) continue;
+
+        const fs::path file = home / path;
+        const std::string to = this->link(path).string();
+
+        struct stat st;
+        if (lstat(file.c_str(), &st))
+        {
+            create.emplace_back(to, file.string());
+            parents.insert(file.parent_path());
+            continue;
+        }
+        if (S_ISLNK(st.st_mode) && target(file) == to) continue;
+
+        // a file of the content of either commit is safe to replace
+        auto known = index.find(path);
+        if (S_ISREG(st.st_mode) && known != index.end() &&
+            (known->second.hash == entry.hash ||
+             (was != prev.end() && known->second.hash == was->second.hash)) &&
+            same(st, known->second))
+        {
+            (known->second.hash == entry.hash ? late : early)
+                .emplace_back(to, file.string());
+            continue;
+        }
+        conflicts.push_back(path);
+    }
+
+    // a copy of the active farm edited through its link is lost by the
+    // switch, unless it was added since
+    if (result.commit != current)
+        for (auto & [path, entry] : prev)
+        {
+            const fs::path file = home / path;
+            auto known = index.find(path);
+            struct stat st;
+            if (target(file) == this->link(path).string() &&
+                !stat(file.c_str(), &st) &&
+                (known == index.end() || !same(st, known->second)))
+                conflicts.push_back(path);
+        }
+
+    for (auto & [path, entry] : prev)
+        if (!next.count(path) && target(home / path) == this->link(path).string())
+            remove.push_back((home / path).string());
+
+    if (conflicts.size())
+        throw cli::Exception("Activating would overwrite " +
+                             std::to_string(conflicts.size()) + " files, " +
+                             (home / conflicts.front()).string(),
+                             "Move them away, or 'dotfiles add' and commit them");
+
+    // the replacements are staged next to the files and listed in the journal
+    // of the farm, an activation cut short is settled by the next one
+    const fs::path journal = this->journal(result.commit);
+    if (early.size() || late.size())
+    {
+        const fs::path tmp = journal.string() + ".tmp";
+        std::ofstream out(tmp, std::ios::trunc);
+        for (auto & [to, file] : early) out << file << '\n';
+        for (auto & [to, file] : late) out << file << '\n';
+        if (!out.flush())
+            throw cli::Exception("Cannot write " + tmp.string());
+        fs::rename(tmp, journal);
+    }
+
+    // links of the added files, dangling until the switch, and the staged
+    // replacements
+    for (auto & dir : parents) fs::create_directories(dir);
+    for (auto & [to, file] : create) links.symlink(to, file);
+    for (auto & [to, file] : early) links.symlink(to, file + ".dotfiles-new");
+    for (auto & [to, file] : late) links.symlink(to, file + ".dotfiles-new");
+    links.flush();
+
+    // the files of the content of the old commit, which the links resolve to
+    // until the switch
+    for (auto & [to, file] : early) links.rename(file + ".dotfiles-new", file);
+    links.flush();
+
+    // the switch
+    const fs::path active = this->store.get_root() / "active";
+    const fs::path tmp = this->store.get_root() / "active.new";
+    unlink(tmp.c_str());
+    if (symlink(("farms/" + result.commit).c_str(), tmp.c_str()) ||
+        rename(tmp.c_str(), active.c_str()))
+        throw cli::Exception("Cannot switch " + active.string() + ": " +
+                             strerror(errno));
+
+    // links of the removed files, dangling since the switch, and the files
+    // of the content of the new commit, which the links resolve to from it
+    for (auto & file : remove) links.unlink(file);
+    for (auto & [to, file] : late) links.rename(file + ".dotfiles-new", file);
+    links.flush();
+    fs::remove(journal);
+
+    // the index follows the home directory, a file of the commit is known by
+    // the stat of its copy and is not read again by the next commit. A file
+    // of both commits that is no link was replaced since, and is left alone
+    for (auto & [path, entry] : prev) if (!next.count(path)) index.erase(path);
+    for (auto & [path, entry] : next)
+    {
+        auto was = prev.find(path);
+        if (was != prev.end() && was->second.hash == entry.hash &&
+            target(home / path) != this->link(path).string()) continue;
+
+        struct stat st;
+        if (stat((home / path).c_str(), &st)) continue;
+        Entry & e = index[path];
+        e = entry;
+        e.ino = st.st_ino, e.size = st.st_size;
+        e.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+    this->store.save(index);
+
+    result.linked = create.size();
+    result.unlinked = remove.size();
+    result.replaced = early.size() + late.size();
+    return result;
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_ACTIVATE_HPP
@@ -0,0 +1,111 @@
+// -*- C++ -*-
+//===----------------------------- alloc.cpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+/**
+ *  Counting replacements of the global operator new and delete, for the
+ *  allocation accounting of alloc.hpp. Link this file into the one binary that
+ *  measures, and build it with CLI_COUNT_ALLOCATIONS defined.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <alloc.hpp>
+
+static void *allocate(std::size_t size, std::size_t align)
+{
+    cli::alloc::current.allocations++;
+    cli::alloc::current.bytes += size;
+
+    if (!size) size = 1;
+    // aligned_alloc wants a size that is a multiple of the alignment
+    void *ptr = align <= alignof(std::max_align_t)
+                    ? std::malloc(size)
+                    : std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (ptr) return ptr;
+    throw std::bad_alloc();
+}
+
+static void release(void *ptr) noexcept
+{
+    if (!ptr) return;
+    cli::alloc::current.deallocations++;
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) { return allocate(size, 0); }
+void *operator new[](std::size_t size) { return allocate(size, 0); }
+
+void *operator new(std::size_t size, std::align_val_t align)
+{
+    return allocate(size, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t size, std::align_val_t align)
+{
+    return allocate(size, static_cast<std::size_t>(align));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try { return allocate(size, 0); }
+    catch (...) { return nullptr; }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try { return allocate(size, 0); }
+    catch (...) { return nullptr; }
+}
+
+void *operator new(std::size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept
+{
+    try { return allocate(size, static_cast<std::size_t>(align)); }
+    catch (...) { return nullptr; }
+}
+
+void *operator new[](std::size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept
+{
+    try { return allocate(size, static_cast<std::size_t>(align)); }
+    catch (...) { return nullptr; }
+}
+
+void operator delete(void *ptr) noexcept { release(ptr); }
+void operator delete[](void *ptr) noexcept { release(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { release(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    release(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { release(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { release(ptr); }
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    release(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    release(ptr);
+}
@@ -0,0 +1,114 @@
+// -*- C++ -*-
+//===----------------------------- chunker.hpp ----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_CHUNKER_HPP
+#define DOTFILES_CHUNKER_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace dotfiles
+{
+
+/**
+ * @brief Content defined chunking (FastCDC). A Gear rolling hash runs over the
+ * bytes and a chunk ends where the hash matches a mask, so the boundaries
+ * depend on the content around them and not on offsets: a line inserted in a
+ * file only changes the chunk it falls in, the chunks after it are found
+ * again and deduplicated. Below the average size the mask has more bits, past
+ * it fewer, which keeps the chunk sizes close to the average.
+ */
+class Chunker
+{
+public:
+    static constexpr std::size_t min = 2 * 1024;
+    static constexpr std::size_t avg = 8 * 1024;
+    static constexpr std::size_t max = 64 * 1024;
+
+private:
+    /**
+     * @brief masks of 15 and 11 high bits, for an average of 2^13 bytes
+     *
+     */
+    static constexpr uint64_t small = ((uint64_t(1) << 15) - 1) << 49;
+    static constexpr uint64_t large = ((uint64_t(1) << 11) - 1) << 53;
+
+    static constexpr std::array<uint64_t, 256> table()
+    {
+        // fixed random values, the boundaries must not change between runs
+        std::array<uint64_t, 256> gear{};
+        uint64_t x = 0x2545f4914f6cdd1dull;
+        for (auto & g : gear)
+        {
+            x += 0x9e3779b97f4a7c15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            g = z ^ (z >> 31);
+        }
+        return gear;
+    }
+
+public:
+    /**
+     * @brief Length of the chunk at the start of the data
+     *
+     * @param data
+     * @param size
+     * @return std::size_t
+     */
+    static std::size_t cut(const unsigned char *data, std::size_t size) noexcept
+    {
+        static constexpr std::array<uint64_t, 256> gear = table();
+
+        if (size <= min) return size;
+        if (size > max) size = max;
+        const std::size_t normal = size < avg ? size : avg;
+
+        uint64_t hash = 0;
+        std::size_t i = min;
+        for (; i < normal; i++)
+        {
+            hash = (hash << 1) + gear[data[i]];
+            if (!(hash & small)) return i + 1;
+        }
+        for (; i < size; i++)
+        {
+            hash = (hash << 1) + gear[data[i]];
+            if (!(hash & large)) return i + 1;
+        }
+        return size;
+    }
+
+    /**
+     * @brief Call the function with the offset and the length of every chunk
+     *
+     * @param data
+     * @param size
+     * @param chunk
+     */
+    template <class Chunk>
+    static void split(const void *data, std::size_t size, Chunk && chunk)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        for (std::size_t offset = 0; offset < size;)
+        {
+            const std::size_t n = cut(p + offset, size - offset);
+            chunk(offset, n);
+            offset += n;
+        }
+    }
+};
+
+} // namespace dotfiles
+
+#endif // DOTFILES_CHUNKER_HPP
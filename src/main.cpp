@@ -13,9 +13,14 @@
 #include <iostream>
 #include <filesystem>
 #include <commander.hpp>
+#include "store.hpp"
+#include "activate.hpp"
+#include "watch.hpp"
 
 #define LINUX 1
 
+static volatile std::sig_atomic_t stopped = 0;
+
 using namespace std;
 using namespace cli;
 
@@ -31,11 +36,18 @@ int32_t main(int argc, char *argv[])
     {
         program.version("1.0");
         program.help();
+        program.external();
 
-        program.command("activate <commit>", "add a file to an env.");
-        program.command("add <path>", "add a file to an env.");
-        program.command("commit", "list the commands available");
+        program.command("activate <commit>", "switch the home directory to a commit.");
+        program.command("add <paths...>", "track files, or every file in directories.");
+        program.command("commit", "record the tracked files in a new commit.");
         program.command("init", "initiate the management of dotfiles.");
+        program.command("watch", "hash the tracked files as they change.", 
+                        [](Commander & watch) {
+            watch.option("-d, --debounce <millis>", 
+                         "coalesce the changes of a file within the window", "200");
+            watch.range("millis", 0, 60000);
+        });
 
         program.option("-m <message>", "provide a message to the commit");
         program.option("-b, --boom", "with aliases");
@@ -44,24 +56,88 @@ int32_t main(int argc, char *argv[])
         // program.option("-de| --doom [party]", "errored");
         // program.command("clone <url> [path]", "clone the repository");
         program.parse(argc, argv);
+
+        // the store resolves $HOME and $DOTFILES_DIR, only build it for the
+        // commands that use it
+        if (program["command"] == "init")
+        {
+            cout << _P("> ") << "Initiating the tracking and management of dotfiles\n";
+            dotfiles::Store().init();
+        }
+
+        if (program["command"] == "add")
+        {
+            const Values & paths = program.values("paths");
+            dotfiles::Store store;
+            dotfiles::Pool pool;
+            dotfiles::Report report = store.add(
+                std::vector<std::string>(paths.begin(), paths.end()), pool);
+
+            cout << _P("> ") << "Tracking " << report.files << " files, "
+                 << report.hashed << " hashed, " << report.stored
+                 << " new objects\n";
+        }
+
+        if (program["command"] == "commit")
+        {
+            dotfiles::Store store;
+            dotfiles::Pool pool;
+            dotfiles::Report report;
+            std::string id = store.commit(program["message"], pool, report);
+
+            if (id.empty()) cout << _P("> ") << "Nothing changed since the last commit\n";
+            else cout << _P("> ") << "Commit " << _S(id.substr(0, 12)) << ", "
+                      << report.files - report.removed << " files, "
+                      << report.hashed << " hashed, " << report.removed
+                      << " removed\n";
+        }
+
+        if (program["command"] == "watch")
+        {
+            dotfiles::Store store;
+            dotfiles::Pool pool;
+            dotfiles::Watcher watcher(store, pool, std::chrono::milliseconds(
+                std::stoul(program["millis"])));
+
+            struct sigaction action = {};
+            action.sa_handler = [](int) { stopped = 1; };
+            sigaction(SIGINT, &action, nullptr);
+            sigaction(SIGTERM, &action, nullptr);
+
+            cout << _P("> ") << "Watching " << watcher.size()
+                 << " directories, ^C to stop\n";
+            watcher.run(stopped, [](const dotfiles::Report & report) {
+                if (report.hashed)
+                    cout << _P("> ") << report.hashed << " files changed, "
+                         << report.stored << " new objects" << endl;
+            });
+        }
+
+        if (program["command"] == "activate")
+        {
+            dotfiles::Store store;
+            dotfiles::Pool pool;
+            dotfiles::Activation done =
+                dotfiles::Farm(store, pool).activate(program["commit"]);
+
+            cout << _P("> ") << "Activated " << _S(done.commit.substr(0, 12))
+                 << ", " << done.linked << " linked, " << done.unlinked
+                 << " unlinked, " << done.replaced << " replaced"
+                 << (done.uring ? " (io_uring)" : "") << "\n";
+        }
     }
     catch (const Exception &e)
     {
         std::cerr << e.what() << '\n';
+        if (e.how().length()) std::cerr << e.how() << '\n';
         exit(1);
     }
-
-    cout << program["message"] << endl;
-
-    if (program["command"] == "init")
+    catch (const std::exception &e)
     {
-        cout << _P("> ") << "Initiating the tracking and management of dotfiles\n";
-    }
-
-    if (program["command"] == "activate")
-    {
-        cout << _P("> ") << "Activate the commit " << _S(program["commit"]) << "\n";
+        // failures of the file system and the like, not of the command line
+        std::cerr << e.what() << '\n';
+        exit(1);
     }
 
     return 0;
-}
\ No newline at end of file
+}
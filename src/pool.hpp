@@ -0,0 +1,215 @@
+// -*- C++ -*-
+//===------------------------------ pool.hpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_POOL_HPP
+#define DOTFILES_POOL_HPP
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace dotfiles
+{
+
+/**
+ * @brief Work stealing thread pool. Every worker has its own queue, it runs
+ * its latest task first and when its queue is empty steals the oldest task of
+ * another worker, so that a batch of uneven tasks (a few huge files among many
+ * small ones) keeps all the workers busy without a shared queue to fight on.
+ */
+class Pool
+{
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    /**
+     * @brief tasks waiting in the queues, and tasks not yet finished
+     *
+     */
+    std::atomic<std::size_t> queued{0}, pending{0};
+
+    std::mutex lock;
+    std::condition_variable wake, idle;
+    std::exception_ptr error;
+    std::size_t next = 0;
+    bool stopping = false;
+
+    /**
+     * @brief index of the worker running on this thread, npos elsewhere
+     *
+     */
+    static thread_local std::size_t self;
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    bool pop(std::size_t from, Task & task);
+    void execute(Task & task) noexcept;
+    void work(std::size_t id);
+
+public:
+    explicit Pool(std::size_t workers = std::thread::hardware_concurrency());
+    ~Pool();
+
+    Pool(const Pool &) = delete;
+    Pool & operator=(const Pool &) = delete;
+
+    /**
+     * @brief Queue a task, on the queue of the calling worker if called from a
+     * task, spread over the workers otherwise
+     *
+     * @param task
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Run tasks until all the submitted tasks are done
+     *
+     * @throw the first exception thrown by a task
+     */
+    void wait();
+
+    std::size_t size() const noexcept { return this->threads.size(); }
+};
+
+thread_local std::size_t Pool::self = Pool::npos;
+
+Pool::Pool(std::size_t workers)
+{
+    if (!workers) workers = 1;
+
+    for (std::size_t i = 0; i < workers; i++)
+        this->queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 0; i < workers; i++)
+        this->threads.emplace_back(&Pool::work, this, i);
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto & t : this->threads) t.join();
+}
+
+/**
+ * @brief Take a task, the newest of the given queue, or else the oldest of the
+ * first other queue that has one
+ *
+ * @param from
+ * @param task
+ * @return true if a task was taken
+ */
+bool Pool::pop(std::size_t from, Task & task)
+{
+    const std::size_t n = this->queues.size();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        Queue & q = *this->queues[(from + i) % n];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) continue;
+
+        if (i == 0) task = std::move(q.tasks.back()), q.tasks.pop_back();
+        else task = std::move(q.tasks.front()), q.tasks.pop_front();
+        this->queued--;
+        return true;
+    }
+    return false;
+}
+
+void Pool::execute(Task & task) noexcept
+{
+    try { task(); }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (!this->error) this->error = std::current_exception();
+    }
+    task = nullptr;
+
+    if (--this->pending == 0)
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->idle.notify_all();
+    }
+}
+
+void Pool::work(std::size_t id)
+{
+    self = id;
+    Task task;
+    for (;;)
+    {
+        if (this->pop(id, task)) { this->execute(task); continue; }
+
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->wake.wait(guard, [this] {
+            return this->stopping || this->queued.load();
+        });
+        if (this->stopping && !this->queued.load()) return;
+    }
+}
+
+void Pool::submit(Task task)
+{
+    std::size_t to = self;
+    if (to == npos || to >= this->queues.size())
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        to = this->next++ % this->queues.size();
+    }
+
+    this->pending++;
+    {
+        Queue & q = *this->queues[to];
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(std::move(task));
+        this->queued++;
+    }
+
+    // taking the lock orders the wake up after a worker checked the queues
+    { std::lock_guard<std::mutex> guard(this->lock); }
+    this->wake.notify_one();
+}
+
+void Pool::wait()
+{
+    // the waiting thread is one more worker until the queues are drained
+    Task task;
+    while (this->pop(0, task)) this->execute(task);
+
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->idle.wait(guard, [this] { return !this->pending.load(); });
+
+    if (std::exception_ptr e = std::exchange(this->error, nullptr))
+        std::rethrow_exception(e);
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_POOL_HPP
@@ -0,0 +1,141 @@
+// -*- C++ -*-
+//===----------------------------- sha256.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_SHA256_HPP
+#define DOTFILES_SHA256_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+namespace dotfiles
+{
+
+/**
+ * @brief SHA-256 of a buffer, the address of the objects in the store.
+ */
+class Sha256
+{
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    unsigned char block[64];
+    std::size_t used = 0;
+    uint64_t length = 0;
+
+    void compress(const unsigned char *p) noexcept;
+
+public:
+    void update(const void *data, std::size_t size) noexcept;
+
+    /**
+     * @brief Finish the hash, returned as lower case hex
+     *
+     * @return std::string
+     */
+    std::string hex();
+
+    static std::string of(const void *data, std::size_t size)
+    {
+        Sha256 h;
+        h.update(data, size);
+        return h.hex();
+    }
+};
+
+void Sha256::compress(const unsigned char *p) noexcept
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 |
+               uint32_t(p[4 * i + 2]) << 8 | uint32_t(p[4 * i + 3]);
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+             e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                      ((e & f) ^ (~e & g)) + k[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
+    }
+
+    state[0] += a, state[1] += b, state[2] += c, state[3] += d;
+    state[4] += e, state[5] += f, state[6] += g, state[7] += h;
+}
+
+void Sha256::update(const void *data, std::size_t size) noexcept
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    this->length += size;
+
+    if (this->used)
+    {
+        std::size_t n = std::min(size, 64 - this->used);
+        std::memcpy(this->block + this->used, p, n);
+        this->used += n, p += n, size -= n;
+        if (this->used < 64) return;
+        this->compress(this->block);
+        this->used = 0;
+    }
+
+    for (; size >= 64; p += 64, size -= 64) this->compress(p);
+
+    std::memcpy(this->block, p, size);
+    this->used = size;
+}
+
+std::string Sha256::hex()
+{
+    const uint64_t bits = this->length * 8;
+    const unsigned char pad = 0x80, zero = 0;
+
+    this->update(&pad, 1);
+    while (this->used != 56) this->update(&zero, 1);
+
+    unsigned char len[8];
+    for (int i = 0; i < 8; i++) len[i] = bits >> (56 - 8 * i);
+    this->update(len, 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string out(64, '0');
+    for (int i = 0; i < 32; i++)
+    {
+        unsigned char byte = this->state[i / 4] >> (24 - 8 * (i % 4));
+        out[2 * i] = digits[byte >> 4], out[2 * i + 1] = digits[byte & 15];
+    }
+    return out;
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_SHA256_HPP
@@ -0,0 +1,962 @@
+// -*- C++ -*-
+//===------------------------------ store.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_STORE_HPP
+#define DOTFILES_STORE_HPP
+
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <ctime>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <filesystem>
+#include <fcntl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
+#include <exception.hpp>
+#include "sha256.hpp"
+#include "chunker.hpp"
+#include "pool.hpp"
+
+namespace dotfiles
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Read only mapping of a whole file, the pages are read by the hash as
+ * it walks them instead of being copied through a buffer.
+ */
+class Mapped
+{
+    void *data = MAP_FAILED;
+    std::size_t length = 0;
+
+public:
+    Mapped(int fd, std::size_t size);
+    ~Mapped() { if (this->data != MAP_FAILED) munmap(this->data, this->length); }
+
+    Mapped(const Mapped &) = delete;
+    Mapped & operator=(const Mapped &) = delete;
+
+    const void * get() const noexcept { return this->data; }
+    std::size_t size() const noexcept { return this->length; }
+};
+
+/**
+ * @brief Exclusive lock of the index of a store, a flock of <root>/index.lock
+ * held from the load of the index to the save of its update. The index is
+ * replaced by a rename on every save, so the lock is a file of its own.
+ */
+class Lock
+{
+    int fd = -1;
+
+public:
+    explicit Lock(const std::filesystem::path & root);
+    ~Lock() { if (this->fd >= 0) close(this->fd); }
+
+    Lock(const Lock &) = delete;
+    Lock & operator=(const Lock &) = delete;
+};
+
+/**
+ * @brief A tracked file, its object and the stat it had when it was hashed
+ */
+struct Entry
+{
+    std::string hash;
+    uint32_t mode = 0;
+    uint64_t ino = 0, size = 0;
+
+    /**
+     * @brief modification time in nanoseconds
+     *
+     */
+    int64_t mtime = 0;
+};
+
+/**
+ * @brief Tracked files by their path relative to the home directory
+ */
+using Index = std::map<std::string, Entry, std::less<>>;
+
+/**
+ * @brief Files of a commit by their path, with their hash and mode only
+ */
+using Tree = Index;
+
+/**
+ * @brief Counts of an add or a commit
+ */
+struct Report
+{
+    std::size_t files = 0, hashed = 0, stored = 0, removed = 0;
+
+    /**
+     * @brief bytes of the files hashed, and bytes written to the store
+     *
+     */
+    uint64_t bytes = 0, written = 0;
+};
+
+/**
+ * @brief Content addressed store of the dotfiles. Every file is an object
+ * named by the SHA-256 of its content, a commit is an object listing a tree
+ * object of (hash, mode, path) lines. The index remembers the inode, size and
+ * mtime of every tracked file when it was hashed, so refreshing an unchanged
+ * file is one stat and the only files read are the changed ones, hashed in
+ * parallel on the pool. The mode of a file is kept in the trees only, as an
+ * object is shared by every file of its content, and the root is private to
+ * its owner since the objects hold private files too.
+ *
+ * Files of a few chunks or more are split by content defined chunks, and
+ * stored as a recipe listing their chunks. A chunk is stored once, whatever
+ * the files and the versions it is found in, so a new version of a large file
+ * costs the chunks around its changes. The file is only put together again
+ * where it is checked out.
+ *
+ *  <root>/objects/ab/cdef...   objects, read only
+ *  <root>/recipes/ab/cdef...   "chunk size" lines of the chunked files
+ *  <root>/chunks/ab/cdef...    chunks of the chunked files
+ *  <root>/chunks.idx           hashes of the stored chunks
+ *  <root>/index                tracked files and their stat
+ *  <root>/index.lock           lock of the index, see Lock
+ *  <root>/HEAD                 latest commit
+ */
+class Store
+{
+    fs::path root, home;
+
+    /**
+     * @brief files stat'ed and hashed by a single task of the pool
+     *
+     */
+    static constexpr std::size_t batch = 64;
+
+    /**
+     * @brief files from this size are chunked
+     *
+     */
+    static constexpr std::size_t chunked = 2 * Chunker::avg;
+
+    /**
+     * @brief the chunk index, loaded with the first chunk stored
+     *
+     */
+    mutable std::mutex chunk_lock;
+    mutable std::once_flag chunk_once;
+    mutable std::unordered_set<std::string> chunks;
+
+    fs::path path(const char *dir, std::string_view hash) const
+    {
+        return this->root / dir / hash.substr(0, 2) / hash.substr(2);
+    }
+
+    void write(const fs::path & path, std::string_view data) const;
+    std::string put(const void *data, std::size_t size,
+                    uint64_t *written = nullptr) const;
+    std::string put_chunk(const unsigned char *data, std::size_t size,
+                          uint64_t & written) const;
+    std::string put_file(const void *data, std::size_t size,
+                         uint64_t & written) const;
+    std::string assemble(std::string_view hash) const;
+    bool hash(const std::string & path, Entry & entry, uint64_t & written) const;
+    Report refresh(std::vector<Index::value_type *> & entries, Pool & pool) const;
+
+public:
+    explicit Store(fs::path r = locate(), fs::path h = home_dir())
+        : root(fs::absolute(r)), home(fs::absolute(h)) {}
+
+    /**
+     * @brief Home directory of the user, $HOME or else the passwd entry
+     *
+     * @return fs::path
+     */
+    static fs::path home_dir();
+
+    /**
+     * @brief Root of the store, $DOTFILES_DIR or else ~/.dotfiles
+     *
+     * @return fs::path
+     */
+    static fs::path locate();
+
+    /**
+     * @brief Create the store, keeping the objects of an existing one. The
+     * root is made private to its owner
+     *
+     */
+    void init() const;
+    bool exists() const { return fs::exists(this->root / "index"); }
+
+    const fs::path & get_root() const noexcept { return this->root; }
+    const fs::path & get_home() const noexcept { return this->home; }
+
+    /**
+     * @brief Path of the object of the hash
+     *
+     * @param hash
+     * @return fs::path
+     */
+    fs::path object(std::string_view hash) const;
+
+    /**
+     * @brief Write the content of the entry to a new file of its mode. The
+     * object of a whole file is cloned where the file system supports it, a
+     * chunked file is written straight out of its chunks and is never kept
+     * whole in the store.
+     *
+     * @param entry
+     * @param to
+     */
+    void checkout(const Entry & entry, const fs::path & to) const;
+
+    /**
+     * @brief Content of an object
+     *
+     * @param hash
+     * @return std::string
+     */
+    std::string read(std::string_view hash) const;
+
+    /**
+     * @brief Lock the index, for the load, update and save of the index not
+     * to interleave with the ones of add, commit, activate or watch running
+     * in another process. The lock is not recursive.
+     *
+     * @return Lock
+     */
+    Lock lock() const { return Lock(this->root); }
+
+    Index load() const;
+    void save(const Index & index) const;
+
+    /**
+     * @brief Latest commit, empty before the first commit
+     *
+     * @return std::string
+     */
+    std::string head() const;
+
+    /**
+     * @brief Full id of the commit given as HEAD or as a prefix of its id
+     *
+     * @param name
+     * @return std::string
+     * @throw cli::Exception if no single commit matches
+     */
+    std::string resolve(std::string_view name) const;
+
+    /**
+     * @brief Files of the commit
+     *
+     * @param commit
+     * @return Tree
+     */
+    Tree tree(std::string_view commit) const;
+
+    /**
+     * @brief Track the files, and every file below the directories
+     *
+     * @param paths
+     * @param pool
+     * @return Report
+     * @throw cli::Exception if a path is missing or outside the home directory
+     */
+    Report add(const std::vector<std::string> & paths, Pool & pool) const;
+
+    /**
+     * @brief Hash the tracked files among the paths that changed, the entries
+     * of files that are gone are kept for the next commit to drop. The caller
+     * loads the index and saves it under the lock
+     *
+     * @param index
+     * @param paths relative to the home directory
+     * @param pool
+     * @return Report
+     */
+    Report update(Index & index, const std::vector<std::string> & paths,
+                  Pool & pool) const;
+
+    /**
+     * @brief Hash the changed tracked files and record them in a new commit
+     *
+     * @param message
+     * @param pool
+     * @param report
+     * @return std::string the commit, empty if nothing changed since HEAD
+     */
+    std::string commit(const std::string & message, Pool & pool,
+                       Report & report) const;
+};
+
+Lock::Lock(const std::filesystem::path & root)
+{
+    const std::string path = (root / "index.lock").string();
+    this->fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (this->fd < 0 && errno == ENOENT)
+        throw cli::Exception("Not a dotfiles store " + root.string(),
+                             "Run 'dotfiles init' first");
+    if (this->fd < 0)
+        throw cli::Exception("Cannot lock " + path + ": " + strerror(errno));
+
+    while (flock(this->fd, LOCK_EX))
+        if (errno != EINTR)
+        {
+            const int err = errno;
+            close(this->fd);
+            throw cli::Exception("Cannot lock " + path + ": " + strerror(err));
+        }
+}
+
+Mapped::Mapped(int fd, std::size_t size) : length(size)
+{
+    this->data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (this->data == MAP_FAILED)
+        throw cli::Exception(std::string("mmap failed: ") + strerror(errno));
+    madvise(this->data, size, MADV_SEQUENTIAL);
+}
+
+fs::path Store::home_dir()
+{
+    if (const char *h = getenv("HOME"); h && *h) return h;
+    if (const passwd *pw = getpwuid(getuid())) return pw->pw_dir;
+    throw cli::Exception("Cannot find the home directory", "Set $HOME");
+}
+
+fs::path Store::locate()
+{
+    if (const char *d = getenv("DOTFILES_DIR"); d && *d) return d;
+    return home_dir() / ".dotfiles";
+}
+
+void Store::init() const
+{
+    // the objects are the content of private files too, only the owner may
+    // enter the store, whatever the modes of the files inside
+    fs::create_directories(this->root / "objects");
+    fs::permissions(this->root, fs::perms::owner_all, fs::perm_options::replace);
+    if (!fs::exists(this->root / "index")) this->write(this->root / "index", "");
+}
+
+fs::path Store::object(std::string_view hash) const
+{
+    return this->path("objects", hash);
+}
+
+/**
+ * @brief Replace the file with the data, readers see the old or the new file
+ * but never a part of it
+ *
+ * @param path
+ * @param data
+ */
+void Store::write(const fs::path & path, std::string_view data) const
+{
+    static std::atomic<unsigned> serial{0};
+    const std::string tmp = path.string() + ".tmp." + std::to_string(getpid()) +
+                            "." + std::to_string(serial++);
+
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw cli::Exception("Cannot write " + tmp + ": " + strerror(errno));
+
+    for (std::size_t done = 0; done < data.size();)
+    {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0)
+        {
+            std::string err = strerror(errno);
+            close(fd), unlink(tmp.c_str());
+            throw cli::Exception("Cannot write " + tmp + ": " + err);
+        }
+        done += n;
+    }
+    close(fd);
+
+    if (rename(tmp.c_str(), path.c_str()))
+    {
+        std::string err = strerror(errno);
+        unlink(tmp.c_str());
+        throw cli::Exception("Cannot write " + path.string() + ": " + err);
+    }
+}
+
+/**
+ * @brief Store the data as an object, unless the object already exists
+ *
+ * @param data
+ * @param size
+ * @param stored set if the object was written
+ * @return std::string the hash
+ */
+std::string Store::put(const void *data, std::size_t size,
+                       uint64_t *written) const
+{
+    std::string hash = Sha256::of(data, size);
+    const fs::path path = this->object(hash);
+
+    if (access(path.c_str(), F_OK) == 0) return hash;
+
+    // concurrent writers of a directory both succeed, mkdir races are fine
+    mkdir(path.parent_path().c_str(), 0755);
+    this->write(path, std::string_view(static_cast<const char *>(data), size));
+    chmod(path.c_str(), 0444);
+
+    if (written) *written += size;
+    return hash;
+}
+
+/**
+ * @brief Store the chunk unless the chunk index has it
+ *
+ * @param data
+ * @param size
+ * @param written
+ * @return std::string the hash
+ */
+std::string Store::put_chunk(const unsigned char *data, std::size_t size,
+                             uint64_t & written) const
+{
+    std::call_once(this->chunk_once, [this] {
+        std::ifstream in(this->root / "chunks.idx");
+        for (std::string line; std::getline(in, line);)
+            if (line.size() == 64) this->chunks.insert(line);
+    });
+
+    std::string hash = Sha256::of(data, size);
+    {
+        std::lock_guard<std::mutex> guard(this->chunk_lock);
+        if (this->chunks.count(hash)) return hash;
+    }
+
+    // the chunk is on disk before the index tells it is
+    const fs::path path = this->path("chunks", hash);
+    fs::create_directories(path.parent_path());
+    this->write(path, std::string_view(reinterpret_cast<const char *>(data),
+                                       size));
+
+    std::lock_guard<std::mutex> guard(this->chunk_lock);
+    if (!this->chunks.insert(hash).second) return hash;
+    written += size;
+
+    std::ofstream out(this->root / "chunks.idx", std::ios::app);
+    out << hash << '\n';
+    if (!out)
+        throw cli::Exception("Cannot write " +
+                             (this->root / "chunks.idx").string());
+    return hash;
+}
+
+/**
+ * @brief Store the content of a file, split in chunks if large enough
+ *
+ * @param data
+ * @param size
+ * @param written
+ * @return std::string the hash of the file
+ */
+std::string Store::put_file(const void *data, std::size_t size,
+                            uint64_t & written) const
+{
+    if (size < chunked) return this->put(data, size, &written);
+
+    std::string hash = Sha256::of(data, size);
+    const fs::path recipe = this->path("recipes", hash);
+    if (access(recipe.c_str(), F_OK) == 0 ||
+        access(this->object(hash).c_str(), F_OK) == 0)
+        return hash;
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    std::string lines;
+    Chunker::split(data, size, [&](std::size_t offset, std::size_t n) {
+        lines += this->put_chunk(p + offset, n, written);
+        lines += ' ' + std::to_string(n) + '\n';
+    });
+
+    fs::create_directories(recipe.parent_path());
+    this->write(recipe, lines);
+    written += lines.size();
+    return hash;
+}
+
+/**
+ * @brief Content of a chunked file, from its recipe
+ *
+ * @param hash
+ * @return std::string
+ */
+std::string Store::assemble(std::string_view hash) const
+{
+    std::ifstream recipe(this->path("recipes", hash));
+    if (!recipe)
+        throw cli::Exception("Unknown object " + std::string(hash),
+                             "The store at " + this->root.string() +
+                             " may be damaged");
+
+    std::string content, chunk;
+    std::size_t size = 0;
+    while (recipe >> chunk >> size)
+    {
+        std::ifstream in(this->path("chunks", chunk), std::ios::binary);
+        const std::size_t at = content.size();
+        content.resize(at + size);
+        if (!in.read(&content[at], size))
+            throw cli::Exception("Missing chunk " + chunk + " of " +
+                                 std::string(hash), "The store at " +
+                                 this->root.string() + " may be damaged");
+    }
+    return content;
+}
+
+/**
+ * @brief Append the next size bytes of the file in to the file out
+ *
+ * @param out
+ * @param in
+ * @param size
+ * @return false on a failure or a short file
+ */
+static bool append(int out, int in, off_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = sendfile(out, in, nullptr, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        size -= n;
+    }
+    return true;
+}
+
+void Store::checkout(const Entry & entry, const fs::path & to) const
+{
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (out < 0)
+        throw cli::Exception("Cannot create " + to.string() + ": " +
+                             strerror(errno));
+
+    auto fail = [&](const std::string & what) {
+        const std::string err = strerror(errno);
+        close(out), unlink(to.c_str());
+        throw cli::Exception(what + ": " + err, "The store at " +
+                             this->root.string() + " may be damaged");
+    };
+
+    const fs::path object = this->object(entry.hash);
+    int in = open(object.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in >= 0)
+    {
+        struct stat st;
+        const bool ok = !fstat(in, &st) && (!ioctl(out, FICLONE, in) ||
+                                             append(out, in, st.st_size));
+        close(in);
+        if (!ok) fail("Cannot copy " + object.string());
+    }
+    else
+    {
+        std::ifstream recipe(this->path("recipes", entry.hash));
+        if (!recipe) fail("Unknown object " + entry.hash);
+
+        std::string chunk;
+        off_t size = 0;
+        while (recipe >> chunk >> size)
+        {
+            const fs::path path = this->path("chunks", chunk);
+            in = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            const bool ok = in >= 0 && append(out, in, size);
+            if (in >= 0) close(in);
+            if (!ok) fail("Missing chunk " + chunk + " of " + entry.hash);
+        }
+    }
+
+    if (fchmod(out, entry.mode & 07777)) fail("Cannot set the mode of " + to.string());
+    if (close(out))
+    {
+        const std::string err = strerror(errno);
+        unlink(to.c_str());
+        throw cli::Exception("Cannot copy " + to.string() + ": " + err);
+    }
+}
+
+/**
+ * @brief Hash the file into the store and record its stat in the entry
+ *
+ * @param path
+ * @param entry
+ * @param written bytes written to the store
+ * @return false if the file is gone
+ */
+bool Store::hash(const std::string & path, Entry & entry,
+                 uint64_t & written) const
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT) return false;
+    if (fd < 0) throw cli::Exception("Cannot read " + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    try
+    {
+        if (st.st_size)
+        {
+            Mapped map(fd, st.st_size);
+            entry.hash = this->put_file(map.get(), map.size(), written);
+        }
+        else entry.hash = this->put("", 0, &written);
+    }
+    catch (...) { close(fd); throw; }
+    close(fd);
+
+    // the mode is the entry's, an object is shared by the files of its content
+    entry.mode = st.st_mode & 07777;
+    entry.ino = st.st_ino, entry.size = st.st_size;
+    entry.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+/**
+ * @brief Stat the entries and hash the changed ones, in batches on the pool.
+ * Entries of files that are gone are left with an empty hash.
+ *
+ * @param entries
+ * @param pool
+ * @return Report
+ */
+Report Store::refresh(std::vector<Index::value_type *> & entries,
+                      Pool & pool) const
+{
+    std::atomic<std::size_t> hashed{0}, stored{0}, removed{0};
+    std::atomic<uint64_t> bytes{0}, written{0};
+
+    for (std::size_t first = 0; first < entries.size(); first += batch)
+    {
+        const std::size_t last = std::min(first + batch, entries.size());
+        pool.submit([&, first, last] {
+            std::string path;
+            for (std::size_t i = first; i < last; i++)
+            {
+                auto & [key, entry] = *entries[i];
+                path = (this->home / key).string();
+
+                struct stat st;
+                if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+                    entry.hash.size() && entry.ino == st.st_ino &&
+                    entry.size == uint64_t(st.st_size) &&
+                    entry.mtime == int64_t(st.st_mtim.tv_sec) * 1000000000 +
+                                       st.st_mtim.tv_nsec)
+                    continue;
+
+                uint64_t wrote = 0;
+                if (!this->hash(path, entry, wrote))
+                {
+                    entry.hash.clear();
+                    removed++;
+                    continue;
+                }
+                hashed++, bytes += entry.size, written += wrote;
+                if (wrote) stored++;
+            }
+        });
+    }
+    pool.wait();
+
+    return Report{entries.size(), hashed, stored, removed, bytes, written};
+}
+
+std::string Store::read(std::string_view hash) const
+{
+    std::ifstream in(this->object(hash), std::ios::binary);
+    if (!in && fs::exists(this->path("recipes", hash)))
+        return this->assemble(hash);
+    if (!in)
+        throw cli::Exception("Unknown object " + std::string(hash),
+                             "The store at " + this->root.string() +
+                             " may be damaged");
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+/**
+ * @brief Read the index, one "hash mode inode size mtime path" line per file
+ *
+ * @return Index
+ */
+Index Store::load() const
+{
+    std::ifstream in(this->root / "index", std::ios::binary);
+    if (!in)
+        throw cli::Exception("Not a dotfiles store " + this->root.string(),
+                             "Run 'dotfiles init' first");
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    Index index;
+    const char *p = text.c_str(), *end = p + text.size();
+    while (p < end)
+    {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+
+        Entry entry;
+        const char *sp = static_cast<const char *>(memchr(p, ' ', eol - p));
+        char *next = nullptr;
+        if (sp)
+        {
+            entry.hash.assign(p, sp);
+            entry.mode = strtoul(sp + 1, &next, 8);
+            entry.ino = strtoull(next, &next, 10);
+            entry.size = strtoull(next, &next, 10);
+            entry.mtime = strtoll(next, &next, 10);
+        }
+        if (!sp || next >= eol || *next != ' ')
+            throw cli::Exception("Corrupted index " +
+                                 (this->root / "index").string(),
+                                 "Run 'dotfiles add' on the files again");
+
+        const char *path = next + 1;
+        index.emplace_hint(index.end(), std::string(path, eol), std::move(entry));
+        p = eol + 1;
+    }
+    return index;
+}
+
+void Store::save(const Index & index) const
+{
+    std::string text;
+    text.reserve(index.size() * 128);
+
+    char line[128];
+    for (auto & [path, e] : index)
+    {
+        int n = snprintf(line, sizeof line, "%s %o %llu %llu %lld ",
+                         e.hash.c_str(), e.mode, (unsigned long long)e.ino,
+                         (unsigned long long)e.size, (long long)e.mtime);
+        text.append(line, n).append(path).push_back('\n');
+    }
+    this->write(this->root / "index", text);
+}
+
+std::string Store::head() const
+{
+    std::ifstream in(this->root / "HEAD");
+    std::string id;
+    std::getline(in, id);
+    return id;
+}
+
+std::string Store::resolve(std::string_view name) const
+{
+    if (name == "HEAD" && this->head().size()) return this->head();
+
+    const bool hex = name.find_first_not_of("0123456789abcdef") ==
+                     std::string_view::npos;
+    std::vector<std::string> found;
+    if (hex && name.size() >= 4)
+    {
+        const fs::path dir = this->root / "objects" / name.substr(0, 2);
+        const std::string_view rest = name.substr(2);
+        std::error_code ec;
+        for (auto & file : fs::directory_iterator(dir, ec))
+        {
+            const std::string tail = file.path().filename().string();
+            if (tail.size() != 62 || tail.compare(0, rest.size(), rest)) continue;
+
+            // a commit starts with "tree ", only the header of the object is
+            // read to tell it from the files
+            char header[5];
+            std::ifstream in(file.path(), std::ios::binary);
+            if (in.read(header, sizeof header) &&
+                std::string_view(header, sizeof header) == "tree ")
+                found.push_back(std::string(name.substr(0, 2)) + tail);
+        }
+    }
+
+    if (found.size() == 1) return found.front();
+    if (found.empty())
+        throw cli::Exception("Unknown commit " + std::string(name),
+                             "Give the id printed by 'dotfiles commit', or "
+                             "at least its first 4 characters");
+    throw cli::Exception("Ambiguous commit " + std::string(name),
+                         "Give more characters of the id");
+}
+
+Tree Store::tree(std::string_view commit) const
+{
+    const std::string text = this->read(commit);
+    if (text.rfind("tree ", 0) != 0 || text.size() < 69)
+        throw cli::Exception("Not a commit " + std::string(commit));
+
+    // "hash mode path" lines, sorted by path
+    const std::string list = this->read(std::string_view(text).substr(5, 64));
+    Tree tree;
+    for (std::size_t p = 0; p < list.size();)
+    {
+        std::size_t eol = list.find('\n', p);
+        if (eol == std::string::npos) eol = list.size();
+
+        const std::size_t path = list.find(' ', p + 65);
+        if (path == std::string::npos || path > eol)
+            throw cli::Exception("Corrupted tree of " + std::string(commit));
+
+        Entry entry;
+        entry.hash = list.substr(p, 64);
+        entry.mode = strtoul(list.c_str() + p + 65, nullptr, 8);
+        tree.emplace_hint(tree.end(), list.substr(path + 1, eol - path - 1),
+                          std::move(entry));
+        p = eol + 1;
+    }
+    return tree;
+}
+
+Report Store::add(const std::vector<std::string> & paths, Pool & pool) const
+{
+    const Lock guard = this->lock();
+    Index index = this->load();
+    std::vector<Index::value_type *> entries;
+
+    auto track = [&](const fs::path & file) {
+        const fs::path rel = file.lexically_relative(this->home);
+        const std::string key = rel.string();
+        if (rel.empty() || key == "." || key.rfind("..", 0) == 0)
+            throw cli::Exception("Path outside the home directory " +
+                                 file.string(), "Only files under " +
+                                 this->home.string() + " can be tracked");
+        if (key.find('\n') != std::string::npos)
+            throw cli::Exception("Unsupported file name " + file.string());
+
+        entries.push_back(&*index.try_emplace(key).first);
+    };
+
+    for (const std::string & path : paths)
+    {
+        const fs::path file = fs::absolute(path).lexically_normal();
+        std::error_code ec;
+        const fs::file_status status = fs::status(file, ec);
+
+        if (!fs::exists(status))
+            throw cli::Exception("No such file " + path);
+
+        if (!fs::is_directory(status)) { track(file); continue; }
+
+        // every regular file below, but never the store itself
+        for (auto it = fs::recursive_directory_iterator(file,
+                 fs::directory_options::skip_permission_denied);
+             it != fs::recursive_directory_iterator(); ++it)
+        {
+            if (it->path() == this->root) { it.disable_recursion_pending(); continue; }
+            if (it->is_regular_file()) track(it->path());
+        }
+    }
+
+    // a file given twice is refreshed once
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    Report report = this->refresh(entries, pool);
+    for (auto *e : entries) if (e->second.hash.empty()) index.erase(e->first);
+    this->save(index);
+    return report;
+}
+
+Report Store::update(Index & index, const std::vector<std::string> & paths,
+                     Pool & pool) const
+{
+    std::vector<Index::value_type *> entries;
+    std::vector<Entry> before;
+    for (const std::string & path : paths)
+    {
+        auto it = index.find(path);
+        if (it == index.end()) continue;
+        entries.push_back(&*it);
+        before.push_back(it->second);
+    }
+
+    Report report = this->refresh(entries, pool);
+    for (std::size_t i = 0; i < entries.size(); i++)
+        if (entries[i]->second.hash.empty()) entries[i]->second = before[i];
+    return report;
+}
+
+std::string Store::commit(const std::string & message, Pool & pool,
+                          Report & report) const
+{
+    const Lock guard = this->lock();
+    Index index = this->load();
+    if (index.empty())
+        throw cli::Exception("Nothing to commit",
+                             "Track files with 'dotfiles add <paths...>'");
+
+    std::vector<Index::value_type *> entries;
+    entries.reserve(index.size());
+    for (auto & e : index) entries.push_back(&e);
+
+    report = this->refresh(entries, pool);
+    for (auto it = index.begin(); it != index.end();)
+        it = it->second.hash.empty() ? index.erase(it) : std::next(it);
+    this->save(index);
+
+    std::string tree;
+    tree.reserve(index.size() * 96);
+    char mode[16];
+    for (auto & [path, e] : index)
+    {
+        snprintf(mode, sizeof mode, " %o ", e.mode);
+        tree.append(e.hash).append(mode).append(path).push_back('\n');
+    }
+    const std::string tree_hash = this->put(tree.data(), tree.size());
+
+    // a commit of the tree of HEAD would record nothing new
+    const std::string parent = this->head();
+    if (parent.size())
+    {
+        const std::string previous = this->read(parent);
+        if (previous.compare(0, 5 + tree_hash.size(), "tree " + tree_hash) == 0)
+            return "";
+    }
+
+    std::string commit = "tree " + tree_hash + "\n";
+    if (parent.size()) commit += "parent " + parent + "\n";
+    commit += "date " + std::to_string(std::time(nullptr)) + "\n";
+    commit += "message " + message + "\n";
+
+    const std::string id = this->put(commit.data(), commit.size());
+    this->write(this->root / "HEAD", id + "\n");
+    return id;
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_STORE_HPP
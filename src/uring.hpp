@@ -0,0 +1,377 @@
+// -*- C++ -*-
+//===------------------------------ uring.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_URING_HPP
+#define DOTFILES_URING_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <exception.hpp>
+#include "pool.hpp"
+
+namespace dotfiles
+{
+
+/**
+ * @brief Minimal io_uring, set up with the raw syscalls so that there is no
+ * dependency on liburing. Only what a batch of path operations needs: fill
+ * submission entries, submit them all with one syscall and reap the results.
+ */
+class Uring
+{
+    int fd = -1;
+    unsigned entries = 0;
+
+    void *sq_ring = MAP_FAILED, *cq_ring = MAP_FAILED;
+    std::size_t sq_size = 0, cq_size = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+
+    unsigned *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    /**
+     * @brief entries filled and not yet submitted
+     *
+     */
+    unsigned queued = 0;
+
+    explicit Uring(unsigned depth);
+
+    static unsigned * field(void *ring, uint32_t offset) noexcept
+    {
+        return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+    }
+
+public:
+    /**
+     * @brief A ring of the depth that supports all the operations
+     *
+     * @param depth
+     * @param ops
+     * @return std::unique_ptr<Uring> null if io_uring or an op is unavailable
+     */
+    static std::unique_ptr<Uring> create(unsigned depth,
+                                         std::initializer_list<int> ops);
+    ~Uring();
+
+    Uring(const Uring &) = delete;
+    Uring & operator=(const Uring &) = delete;
+
+    unsigned depth() const noexcept { return this->entries; }
+
+    /**
+     * @brief Next free submission entry, cleared, at most depth() entries can
+     * be filled before submit()
+     *
+     * @return io_uring_sqe&
+     */
+    io_uring_sqe & next() noexcept;
+
+    /**
+     * @brief Submit the filled entries and wait for all of them
+     *
+     * @param done called with the user_data and the result of every entry
+     */
+    template <class Done> void submit(Done && done);
+};
+
+Uring::Uring(unsigned depth)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof params);
+
+    this->fd = syscall(__NR_io_uring_setup, depth, &params);
+    if (this->fd < 0) return;
+    this->entries = params.sq_entries;
+
+    this->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    this->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) this->sq_size = this->cq_size = std::max(sq_size, cq_size);
+
+    this->sq_ring = mmap(nullptr, this->sq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+    this->cq_ring = single ? this->sq_ring
+                           : mmap(nullptr, this->cq_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, this->fd,
+                                  IORING_OFF_CQ_RING);
+    this->sqes = static_cast<io_uring_sqe *>(
+        mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd,
+             IORING_OFF_SQES));
+
+    if (this->sq_ring == MAP_FAILED || this->cq_ring == MAP_FAILED ||
+        this->sqes == MAP_FAILED)
+    {
+        close(this->fd);
+        this->fd = -1;
+        return;
+    }
+
+    this->sq_tail = field(this->sq_ring, params.sq_off.tail);
+    this->sq_mask = field(this->sq_ring, params.sq_off.ring_mask);
+    this->sq_array = field(this->sq_ring, params.sq_off.array);
+    this->cq_head = field(this->cq_ring, params.cq_off.head);
+    this->cq_tail = field(this->cq_ring, params.cq_off.tail);
+    this->cq_mask = field(this->cq_ring, params.cq_off.ring_mask);
+    this->cqes = reinterpret_cast<io_uring_cqe *>(
+        static_cast<char *>(this->cq_ring) + params.cq_off.cqes);
+}
+
+Uring::~Uring()
+{
+    if (this->sqes != MAP_FAILED)
+        munmap(this->sqes, this->entries * sizeof(io_uring_sqe));
+    if (this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring)
+        munmap(this->cq_ring, this->cq_size);
+    if (this->sq_ring != MAP_FAILED) munmap(this->sq_ring, this->sq_size);
+    if (this->fd >= 0) close(this->fd);
+}
+
+std::unique_ptr<Uring> Uring::create(unsigned depth,
+                                     std::initializer_list<int> ops)
+{
+    std::unique_ptr<Uring> ring(new Uring(depth));
+    if (ring->fd < 0) return nullptr;
+
+    // the kernel may know io_uring but not the path operations (before 5.15)
+    const std::size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::unique_ptr<char[]> buffer(new char[size]());
+    io_uring_probe *probe = reinterpret_cast<io_uring_probe *>(buffer.get());
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe,
+                256) < 0)
+        return nullptr;
+
+    for (int op : ops)
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+            return nullptr;
+    return ring;
+}
+
+io_uring_sqe & Uring::next() noexcept
+{
+    const unsigned tail = *this->sq_tail + this->queued++;
+    const unsigned idx = tail & *this->sq_mask;
+
+    this->sq_array[idx] = idx;
+    std::memset(&this->sqes[idx], 0, sizeof(io_uring_sqe));
+    return this->sqes[idx];
+}
+
+template <class Done> void Uring::submit(Done && done)
+{
+    const unsigned count = this->queued;
+    if (!count) return;
+
+    // publish the filled entries to the kernel
+    __atomic_store_n(this->sq_tail, *this->sq_tail + count, __ATOMIC_RELEASE);
+    this->queued = 0;
+
+    unsigned submitted = 0, completed = 0;
+    while (completed < count)
+    {
+        int n = syscall(__NR_io_uring_enter, this->fd, count - submitted,
+                        count - completed, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            throw cli::Exception(std::string("io_uring failed: ") +
+                                 strerror(errno));
+        if (n > 0) submitted += n;
+
+        unsigned head = *this->cq_head;
+        const unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, completed++)
+        {
+            const io_uring_cqe & cqe = this->cqes[head & *this->cq_mask];
+            done(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Batch of independent operations on paths, symlinks, unlinks and
+ * renames, queued and then applied all at once. The batch goes through
+ * io_uring, one syscall for as many operations as the ring holds, and falls
+ * back to the syscalls run on the pool where io_uring is not available.
+ */
+class Links
+{
+    enum class Kind { symlink, unlink, rename };
+
+    struct Op
+    {
+        Kind kind;
+        std::string from, to;
+    };
+
+    std::vector<Op> ops;
+    Pool & pool;
+    std::unique_ptr<Uring> ring;
+
+    static std::string failure(const Op & op, int err);
+    void apply_ring();
+    void apply_pool();
+
+public:
+    /**
+     * @brief io_uring is used unless $DOTFILES_URING is 0
+     *
+     * @param p
+     */
+    explicit Links(Pool & p);
+
+    void symlink(std::string target, std::string path)
+    {
+        this->ops.push_back({Kind::symlink, std::move(target), std::move(path)});
+    }
+
+    /**
+     * @brief Remove the path, a path that is already gone is not an error
+     *
+     * @param path
+     */
+    void unlink(std::string path)
+    {
+        this->ops.push_back({Kind::unlink, "", std::move(path)});
+    }
+
+    void rename(std::string from, std::string to)
+    {
+        this->ops.push_back({Kind::rename, std::move(from), std::move(to)});
+    }
+
+    std::size_t size() const noexcept { return this->ops.size(); }
+    bool uring() const noexcept { return this->ring != nullptr; }
+
+    /**
+     * @brief Apply the queued operations, in no particular order
+     *
+     * @throw cli::Exception with the first failed operation
+     */
+    void flush();
+};
+
+Links::Links(Pool & p) : pool(p)
+{
+    const char *use = getenv("DOTFILES_URING");
+    if (use && std::string(use) == "0") return;
+
+    this->ring = Uring::create(256, {IORING_OP_SYMLINKAT, IORING_OP_UNLINKAT,
+                                     IORING_OP_RENAMEAT});
+}
+
+std::string Links::failure(const Op & op, int err)
+{
+    const char *what = op.kind == Kind::symlink ? "Cannot link "
+                     : op.kind == Kind::unlink  ? "Cannot remove "
+                                                : "Cannot replace ";
+    return what + op.to + ": " + strerror(err);
+}
+
+void Links::apply_ring()
+{
+    std::string error;
+    auto done = [&](uint64_t i, int res) {
+        if (res == -ENOENT && this->ops[i].kind == Kind::unlink) return;
+        if (res < 0 && error.empty()) error = failure(this->ops[i], -res);
+    };
+
+    for (std::size_t i = 0; i < this->ops.size(); i++)
+    {
+        const Op & op = this->ops[i];
+        io_uring_sqe & sqe = this->ring->next();
+        sqe.user_data = i;
+        sqe.fd = AT_FDCWD;
+
+        switch (op.kind)
+        {
+        case Kind::symlink:
+            sqe.opcode = IORING_OP_SYMLINKAT;
+            sqe.addr = reinterpret_cast<uint64_t>(op.from.c_str());
+            sqe.addr2 = reinterpret_cast<uint64_t>(op.to.c_str());
+            break;
+        case Kind::unlink:
+            sqe.opcode = IORING_OP_UNLINKAT;
+            sqe.addr = reinterpret_cast<uint64_t>(op.to.c_str());
+            break;
+        case Kind::rename:
+            sqe.opcode = IORING_OP_RENAMEAT;
+            sqe.addr = reinterpret_cast<uint64_t>(op.from.c_str());
+            sqe.len = static_cast<uint32_t>(AT_FDCWD);
+            sqe.addr2 = reinterpret_cast<uint64_t>(op.to.c_str());
+            break;
+        }
+
+        if ((i + 1) % this->ring->depth() == 0) this->ring->submit(done);
+    }
+    this->ring->submit(done);
+
+    if (error.size()) throw cli::Exception(error);
+}
+
+void Links::apply_pool()
+{
+    static constexpr std::size_t batch = 64;
+    std::atomic<bool> failed{false};
+    std::string error;
+
+    for (std::size_t first = 0; first < this->ops.size(); first += batch)
+    {
+        const std::size_t last = std::min(first + batch, this->ops.size());
+        this->pool.submit([&, first, last] {
+            for (std::size_t i = first; i < last; i++)
+            {
+                const Op & op = this->ops[i];
+                int res = op.kind == Kind::symlink
+                              ? ::symlink(op.from.c_str(), op.to.c_str())
+                        : op.kind == Kind::unlink
+                              ? ::unlink(op.to.c_str())
+                              : ::rename(op.from.c_str(), op.to.c_str());
+
+                if (!res || (errno == ENOENT && op.kind == Kind::unlink))
+                    continue;
+                if (!failed.exchange(true)) error = failure(op, errno);
+            }
+        });
+    }
+    this->pool.wait();
+
+    if (failed) throw cli::Exception(error);
+}
+
+void Links::flush()
+{
+    if (this->ops.empty()) return;
+
+    try
+    {
+        if (this->ring) this->apply_ring();
+        else this->apply_pool();
+    }
+    catch (...) { this->ops.clear(); throw; }
+    this->ops.clear();
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_URING_HPP
@@ -0,0 +1,417 @@
+// -*- C++ -*-
+//===------------------------------ watch.hpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef DOTFILES_WATCH_HPP
+#define DOTFILES_WATCH_HPP
+
+#include <set>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <exception.hpp>
+#include "store.hpp"
+#include "pool.hpp"
+
+namespace dotfiles
+{
+
+/**
+ * @brief Keeps the index up to date while files are edited. Every directory
+ * holding a tracked file is watched with inotify, along with the same
+ * directory in the active farm, where a write through a home link lands. The
+ * tracked files named by the events are collected in a dirty set, and once the events stop for the
+ * debounce window (or the burst lasts too long) only the dirty files are
+ * hashed into the store. A commit after that is one stat per file.
+ *
+ * inotify drops events when its queue overflows, the index is then rescanned
+ * by slices of a bounded number of files, interleaved with the events, and
+ * the same rescan also runs periodically in case an event was missed.
+ *
+ * The watcher keeps the index it last read or wrote, with the stat of its
+ * file, and reads it again only when another process replaced it. Every
+ * update is saved under the lock of the index.
+ */
+class Watcher
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief called after every update of the index
+     */
+    using Notify = std::function<void(const Report &)>;
+
+private:
+    const Store & store;
+    Pool & pool;
+    int fd = -1;
+
+    /**
+     * @brief watched directory, relative to the home directory, and whether
+     * it is the one of the active farm
+     *
+     */
+    struct Dir
+    {
+        std::string path;
+        bool farm = false;
+    };
+
+    /**
+     * @brief watched directories by their watch descriptor, the ones of the
+     * home directory and of the farm that <root>/active linked to when they
+     * were watched, and the descriptor of the store
+     *
+     */
+    std::unordered_map<int, Dir> dirs;
+    std::unordered_set<std::string> watched, farmed;
+    std::string farm;
+    int root = -1;
+
+    std::unordered_set<std::string> tracked;
+    std::set<std::string> dirty;
+
+    /**
+     * @brief the index as the watcher last read or wrote it, and the stat of
+     * the index file then
+     *
+     */
+    Index index;
+    struct stat seen = {};
+
+    const Clock::duration debounce, burst, period;
+    Clock::time_point first, last, next_scan;
+
+    /**
+     * @brief files checked by a slice of a rescan, and where the rescan is,
+     * empty when there is no rescan running
+     *
+     */
+    static constexpr std::size_t slice = 4096;
+    std::string cursor;
+    bool scanning = false, rewatch = false;
+
+    bool fresh() const;
+    Index & current();
+    void save();
+    void watch();
+    void drain();
+    void flush(const Notify & notify);
+    void scan(const Notify & notify);
+    int timeout() const;
+
+public:
+    /**
+     * @brief Watch the tracked files
+     *
+     * @param s
+     * @param p
+     * @param window events of a file closer than this are one change
+     * @param rescan interval of the periodic rescans
+     */
+    Watcher(const Store & s, Pool & p, std::chrono::milliseconds window,
+            std::chrono::seconds rescan = std::chrono::minutes(10));
+    ~Watcher() { if (this->fd >= 0) close(this->fd); }
+
+    Watcher(const Watcher &) = delete;
+    Watcher & operator=(const Watcher &) = delete;
+
+    std::size_t size() const noexcept { return this->dirs.size(); }
+
+    /**
+     * @brief Process the events until stop is set, by a signal handler
+     *
+     * @param stop
+     * @param notify
+     */
+    void run(const volatile std::sig_atomic_t & stop, const Notify & notify);
+};
+
+Watcher::Watcher(const Store & s, Pool & p, std::chrono::milliseconds window,
+                 std::chrono::seconds rescan)
+    : store(s), pool(p), debounce(window), burst(window * 10), period(rescan)
+{
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fd < 0)
+        throw cli::Exception(std::string("inotify failed: ") + strerror(errno));
+
+    // the store is watched for the index being replaced by add or commit,
+    // and for the switch of the active farm
+    this->root = inotify_add_watch(this->fd, this->store.get_root().c_str(),
+                                   IN_MOVED_TO | IN_ONLYDIR);
+    if (this->root < 0)
+        throw cli::Exception("Cannot watch " + this->store.get_root().string() +
+                             ": " + strerror(errno));
+
+    this->watch();
+    this->next_scan = Clock::now() + this->period;
+}
+
+/**
+ * @brief Whether the index file is still the one the watcher last read or
+ * wrote, the index is replaced by a rename on every save
+ *
+ * @return true
+ * @return false
+ */
+bool Watcher::fresh() const
+{
+    struct stat st;
+    return !stat((this->store.get_root() / "index").c_str(), &st) &&
+           st.st_ino == this->seen.st_ino && st.st_size == this->seen.st_size &&
+           st.st_mtim.tv_sec == this->seen.st_mtim.tv_sec &&
+           st.st_mtim.tv_nsec == this->seen.st_mtim.tv_nsec;
+}
+
+/**
+ * @brief The index, read again if another process replaced it
+ *
+ * @return Index&
+ */
+Index & Watcher::current()
+{
+    if (this->fresh()) return this->index;
+
+    // the stat is taken first, a save in between is seen by the next call
+    stat((this->store.get_root() / "index").c_str(), &this->seen);
+    this->index = this->store.load();
+    return this->index;
+}
+
+/**
+ * @brief Save the index, the lock must be held
+ *
+ */
+void Watcher::save()
+{
+    this->store.save(this->index);
+    stat((this->store.get_root() / "index").c_str(), &this->seen);
+}
+
+/**
+ * @brief Watch the directories of the tracked files not watched yet
+ *
+ */
+void Watcher::watch()
+{
+    const Index & index = this->current();
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                          IN_CREATE | IN_DELETE | IN_ATTRIB | IN_ONLYDIR;
+    const fs::path active = this->store.get_root() / "active";
+
+    // the directories of a farm no longer active are not watched
+    std::error_code ec;
+    const std::string target = fs::read_symlink(active, ec).string();
+    if (target != this->farm)
+    {
+        for (auto it = this->dirs.begin(); it != this->dirs.end();)
+            if (it->second.farm)
+            {
+                inotify_rm_watch(this->fd, it->first);
+                it = this->dirs.erase(it);
+            }
+            else ++it;
+        this->farmed.clear();
+        this->farm = target;
+    }
+
+    auto add = [&](const fs::path & full, const std::string & dir, bool farm) {
+        int wd = inotify_add_watch(this->fd, full.c_str(), mask);
+        if (wd == -1 && errno == ENOSPC)
+            throw cli::Exception("Too many directories to watch",
+                                 "Raise fs.inotify.max_user_watches");
+        if (wd == -1) return;
+
+        this->dirs[wd] = Dir{dir, farm};
+        (farm ? this->farmed : this->watched).insert(dir);
+    };
+
+    this->tracked.clear();
+    for (auto & [path, entry] : index)
+    {
+        this->tracked.insert(path);
+
+        const std::size_t slash = path.rfind('/');
+        std::string dir = slash == std::string::npos ? "" : path.substr(0, slash);
+        if (!this->watched.count(dir)) add(this->store.get_home() / dir, dir, false);
+        if (!this->farmed.count(dir) && target.size()) add(active / dir, dir, true);
+    }
+    this->rewatch = false;
+}
+
+/**
+ * @brief Read the pending events into the dirty set
+ *
+ */
+void Watcher::drain()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;)
+    {
+        ssize_t n = read(this->fd, buffer, sizeof buffer);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+
+        const Clock::time_point now = Clock::now();
+        for (char *p = buffer; p < buffer + n;)
+        {
+            const inotify_event *e = reinterpret_cast<inotify_event *>(p);
+            p += sizeof(inotify_event) + e->len;
+
+            if (e->mask & IN_Q_OVERFLOW)
+            {
+                // events were lost, only a rescan can tell what changed
+                this->scanning = true, this->cursor.clear();
+                continue;
+            }
+            if (e->wd == this->root)
+            {
+                // the saves of the watcher itself track no new file
+                if (e->len && std::string_view(e->name) == "index" &&
+                    !this->fresh())
+                    this->rewatch = true;
+                if (e->len && std::string_view(e->name) == "active")
+                    this->rewatch = true;
+                continue;
+            }
+
+            auto dir = this->dirs.find(e->wd);
+            if (dir == this->dirs.end()) continue;
+            if (e->mask & IN_IGNORED)
+            {
+                // the directory is gone, it is watched again if it comes back
+                (dir->second.farm ? this->farmed : this->watched)
+                    .erase(dir->second.path);
+                this->dirs.erase(dir);
+                continue;
+            }
+            if (!e->len) continue;
+
+            std::string path = dir->second.path.empty()
+                                   ? std::string(e->name)
+                                   : dir->second.path + "/" + e->name;
+            if (!this->tracked.count(path)) continue;
+
+            if (this->dirty.empty()) this->first = now;
+            this->last = now;
+            this->dirty.insert(std::move(path));
+        }
+    }
+}
+
+/**
+ * @brief Hash the dirty files into the store and the index
+ *
+ * @param notify
+ */
+void Watcher::flush(const Notify & notify)
+{
+    const std::vector<std::string> paths(this->dirty.begin(), this->dirty.end());
+    this->dirty.clear();
+
+    Report report;
+    {
+        const Lock guard = this->store.lock();
+        report = this->store.update(this->current(), paths, this->pool);
+        if (report.hashed) this->save();
+    }
+    if (notify) notify(report);
+}
+
+/**
+ * @brief Check the next slice of the tracked files
+ *
+ * @param notify
+ */
+void Watcher::scan(const Notify & notify)
+{
+    Report report;
+    bool end = false;
+    {
+        const Lock guard = this->store.lock();
+        Index & index = this->current();
+
+        std::vector<std::string> paths;
+        auto it = index.upper_bound(this->cursor);
+        if (this->cursor.empty()) it = index.begin();
+        for (; it != index.end() && paths.size() < slice; ++it)
+            paths.push_back(it->first);
+        end = it == index.end();
+        if (!end) this->cursor = paths.back();
+
+        report = this->store.update(index, paths, this->pool);
+        if (report.hashed) this->save();
+    }
+    if (report.hashed && notify) notify(report);
+
+    if (end)
+    {
+        this->scanning = false, this->cursor.clear();
+        this->next_scan = Clock::now() + this->period;
+        this->rewatch = true;
+    }
+}
+
+/**
+ * @brief Milliseconds to wait for events before the next piece of work
+ *
+ * @return int
+ */
+int Watcher::timeout() const
+{
+    if (this->scanning || this->rewatch) return 0;
+
+    Clock::time_point until = this->next_scan;
+    if (this->dirty.size())
+        until = std::min(this->last + this->debounce, this->first + this->burst);
+
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+        until - Clock::now());
+    return wait.count() < 0 ? 0 : static_cast<int>(wait.count()) + 1;
+}
+
+void Watcher::run(const volatile std::sig_atomic_t & stop, const Notify & notify)
+{
+    pollfd p = {this->fd, POLLIN, 0};
+    while (!stop)
+    {
+        int n = poll(&p, 1, this->timeout());
+        if (n < 0 && errno != EINTR)
+            throw cli::Exception(std::string("poll failed: ") + strerror(errno));
+        if (n > 0) this->drain();
+
+        const Clock::time_point now = Clock::now();
+        if (this->rewatch) this->watch();
+        if (this->dirty.size() && (now >= this->last + this->debounce ||
+                                   now >= this->first + this->burst))
+            this->flush(notify);
+
+        if (!this->scanning && now >= this->next_scan)
+            this->scanning = true, this->cursor.clear();
+        if (this->scanning) this->scan(notify);
+    }
+
+    // the changes seen before the stop are not lost
+    this->drain();
+    if (this->dirty.size()) this->flush(notify);
+}
+
+} // namespace dotfiles
+
+#endif // DOTFILES_WATCH_HPP
@@ -0,0 +1,122 @@
+// -*- C++ -*-
+//===----------------------------- activate.cpp ---------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <sys/stat.h>
+#include "activate.hpp"
+
+/**
+ *  Activation of the commits of a store in a temporary home directory. The
+ *  farm copies keep the mode of the tracked files, an edit through a home
+ *  link changes the copy and never the store, and the edit is neither lost by
+ *  a switch nor seen again in the farm once the commit is activated back.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path & path, const std::string & text, mode_t mode)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::trunc) << text;
+    chmod(path.c_str(), mode);
+}
+
+static std::string read(const fs::path & path)
+{
+    std::ifstream in(path);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+static mode_t mode(const fs::path & path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_mode & 07777;
+}
+
+int main()
+{
+    char dir[] = "/tmp/dotfiles-test-XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    const fs::path home = fs::path(dir) / "home";
+
+    dotfiles::Store store(home / ".dotfiles", home);
+    dotfiles::Pool pool;
+    dotfiles::Farm farm(store, pool);
+    dotfiles::Report report;
+    store.init();
+    CHECK(mode(home / ".dotfiles") == 0700);
+
+    write(home / ".netrc", "machine example\n", 0600);
+    write(home / "cfg" / "a", "one\n", 0644);
+    write(home / "cfg" / "run", "one\n", 0755);
+    store.add({(home / ".netrc").string(), (home / "cfg").string()}, pool);
+    const std::string first = store.commit("first", pool, report);
+
+    write(home / "cfg" / "a", "two\n", 0644);
+    store.add({(home / "cfg" / "a").string()}, pool);
+    const std::string second = store.commit("second", pool, report);
+
+    // the home files of the commit are replaced by links to their copies
+    farm.activate(second);
+    CHECK(fs::is_symlink(home / "cfg" / "a"));
+    CHECK(read(home / "cfg" / "a") == "two\n");
+    CHECK(mode(home / ".netrc") == 0600);
+    CHECK(mode(home / "cfg" / "a") == 0644);
+    CHECK(mode(home / "cfg" / "run") == 0755);
+
+    // an object shared by files of different modes keeps its own
+    const std::string shared = store.tree(first).at("cfg/run").hash;
+    CHECK(mode(store.object(shared)) == 0444);
+
+    farm.activate(first);
+    CHECK(read(home / "cfg" / "a") == "one\n");
+
+    // an edit through the link changes the copy only
+    std::ofstream(home / "cfg" / "a", std::ios::app) << "edit\n";
+    CHECK(read(home / "cfg" / "a") == "one\nedit\n");
+    const std::string hash = store.tree(first).at("cfg/a").hash;
+    CHECK(store.read(hash) == "one\n");
+
+    // and is not lost by a switch until it is added
+    bool refused = false;
+    try { farm.activate(second); }
+    catch (const cli::Exception &) { refused = true; }
+    CHECK(refused);
+    CHECK(read(home / "cfg" / "a") == "one\nedit\n");
+
+    store.add({(home / "cfg" / "a").string()}, pool);
+    farm.activate(second);
+    CHECK(read(home / "cfg" / "a") == "two\n");
+
+    // the farm of the first commit is copied again where it was edited
+    farm.activate(first);
+    CHECK(read(home / "cfg" / "a") == "one\n");
+    CHECK(mode(home / "cfg" / "a") == 0644);
+
+    fs::remove_all(dir);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+// -*- C++ -*-
+//===----------------------------- alloc.cpp ------------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <iostream>
+#include <commander.hpp>
+
+/**
+ *  Allocation bounds of the parse path. The bounds of the registration and of
+ *  a first parse are the counts measured with libstdc++, a change that makes
+ *  them allocate more fails here. Parsing again reuses what the first parse
+ *  allocated, and like reading the result or a parse served from the cache,
+ *  never allocates.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+using cli::alloc::Scope;
+
+int main()
+{
+    static_assert(cli::alloc::enabled(), "build with CLI_COUNT_ALLOCATIONS");
+
+    // the counting operators themselves, aligned ones included
+    {
+        Scope scope;
+        delete new int(1);
+        struct alignas(64) Line { char data[64]; };
+        delete new Line();
+        CHECK(scope.count().allocations == 2);
+        CHECK(scope.count().deallocations == 2);
+    }
+
+    cli::Commander program("dotfiles", "manage dotfiles");
+    {
+        Scope scope;
+        program.option("-m <message>", "commit message");
+        CHECK(scope.count().allocations <= 538);
+    }
+    {
+        Scope scope;
+        program.command("add <paths...>", "track files");
+        CHECK(scope.count().allocations <= 541);
+    }
+    program.option("-b, --boom", "boom");
+    program.command("commit", "commit the tracked files");
+
+    char *argv[] = {(char *)"dotfiles", (char *)"add", (char *)"a", (char *)"b",
+                    (char *)"-m", (char *)"hello"};
+    const int argc = sizeof argv / sizeof *argv;
+    {
+        Scope scope;
+        program.parse(argc, argv);
+        CHECK(scope.count().allocations <= 23);
+        CHECK(scope.count().allocations == program.stats().parse.allocations);
+    }
+    {
+        // a parse reuses the nodes and the buffers of the previous one
+        Scope scope;
+        program.parse(argc, argv);
+        CHECK(scope.count().allocations == 0);
+    }
+    {
+        Scope scope;
+        CHECK(program["command"] == "add");
+        CHECK(program["message"] == "hello");
+        CHECK(program["missing"].empty());
+        CHECK(program.values("paths").size() == 2);
+        CHECK(scope.count().allocations == 0);
+    }
+
+    {
+        // a result held by the caller is never reused
+        cli::Result held = program.result();
+        char *other[] = {(char *)"dotfiles", (char *)"commit", (char *)"-m",
+                         (char *)"bye"};
+        program.parse(4, other);
+        CHECK(program["message"] == "bye");
+        CHECK(held->properties.at("message") == "hello");
+        CHECK(held->lists.at("paths").size() == 2);
+    }
+
+    program.cache(1 << 16);
+    program.parse(argc, argv);
+    {
+        Scope scope;
+        program.parse(argc, argv);
+        CHECK(program["message"] == "hello");
+        CHECK(scope.count().allocations == 0);
+        CHECK(program.stats().parse.allocations == 0);
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,82 @@
+// -*- C++ -*-
+//===------------------------- basic_commander.cpp ------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <iostream>
+#include <alloc.hpp>
+#include <basic_commander.hpp>
+
+/**
+ *  BasicCommander never allocates, from its construction through the parse,
+ *  the reading of the values, the errors and the usage.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+using cli::alloc::Scope;
+
+int main()
+{
+    static_assert(cli::alloc::enabled(), "build with CLI_COUNT_ALLOCATIONS");
+
+    char *argv[] = {(char *)"dotfiles", (char *)"add", (char *)"a", (char *)"b",
+                    (char *)"-m", (char *)"hello", (char *)"--boom"};
+    const int argc = sizeof argv / sizeof *argv;
+    char *unknown[] = {(char *)"dotfiles", (char *)"ad"};
+
+    Scope scope;
+    {
+        cli::BasicCommander<4, 4, 16> program("dotfiles", "manage dotfiles");
+        program.command("add <paths...>", "track files");
+        program.command("commit", "commit the tracked files");
+        program.option("-m, --message <message>", "commit message");
+        program.option("-b, --boom", "boom");
+
+        CHECK(!program.parse(argc, argv));
+        CHECK(program["command"] == "add");
+        CHECK(program["message"] == "hello");
+        CHECK(program["missing"].empty());
+        CHECK(program.count("paths") == 2);
+        CHECK(program.value("paths", 1) == "b");
+        CHECK(program.has("-b") && program.has("--message"));
+
+        cli::ParseError e = program.parse(2, unknown);
+        CHECK(e.code == cli::ParseError::CMD_NOT_FOUND && e.token == "ad");
+        CHECK(std::strlen(e.what()) > 0);
+
+        char usage[512];
+        std::size_t length = 0;
+        program.usage([&](std::string_view s) {
+            const std::size_t n = std::min(s.size(), sizeof usage - length);
+            std::memcpy(usage + length, s.data(), n);
+            length += n;
+        });
+        CHECK(std::string_view(usage, length).find("--message") !=
+              std::string_view::npos);
+
+        // registering beyond the capacity is reported, not allocated for
+        cli::BasicCommander<1, 1, 2> small("small");
+        small.option("-a");
+        small.option("-b");
+        CHECK(small.parse(1, argv).code == cli::ParseError::TOO_MANY_OPTIONS);
+    }
+    CHECK(scope.count().allocations == 0);
+    CHECK(scope.count().deallocations == 0);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// -*- C++ -*-
+//===------------------------------ cache.cpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <memory>
+#include <string>
+#include <iostream>
+#include <commander.hpp>
+
+/**
+ *  A parse served from the cache reads as the parse it replaces: the command
+ *  is selected, the defaults of its options are known even if it is built by
+ *  a builder in another commander, and the args of a previous stream() are
+ *  no longer iterated. The cache is bounded by its capacity.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+static void spec(cli::Commander & program)
+{
+    program.command("add <paths...>", "track files");
+    program.command("watch", "hash the tracked files", [](cli::Commander & c) {
+        c.option("-d, --delay <millis>", "delay of a flush", "200");
+        c.command("stop", "stop the watcher");
+    });
+    program.option("-m, --message <message>", "commit message");
+}
+
+int main()
+{
+    auto cache = std::make_shared<cli::Cache>(1 << 16);
+    cli::Commander first("dotfiles"), second("dotfiles");
+    spec(first), spec(second);
+    first.cache(cache), second.cache(cache);
+
+    char *watch[] = {(char *)"dotfiles", (char *)"watch", (char *)"stop"};
+    first.parse(3, watch);
+    CHECK(first["command"] == "watch stop");
+    CHECK(first["millis"] == "200");
+
+    // the other commander never built the command, the hit builds it
+    second.parse(3, watch);
+    CHECK(second.stats().hits == 1 && second.stats().misses == 1);
+    CHECK(second["command"] == "watch stop");
+    CHECK(second["millis"] == "200");
+    CHECK(second.names().size() == 3);
+
+    // a hit after a stream() leaves no args to iterate
+    char *add[] = {(char *)"dotfiles", (char *)"add", (char *)"a", (char *)"b"};
+    first.parse(4, add);
+    second.stream(4, add);
+    CHECK(second.positionals().begin() != second.positionals().end());
+    second.parse(4, add);
+    CHECK(second.stats().hits == 2);
+    CHECK(second.values("paths").size() == 2);
+    CHECK(second.positionals().begin() == second.positionals().end());
+
+    // a hit with no command selects none
+    char *message[] = {(char *)"dotfiles", (char *)"-m", (char *)"hello"};
+    first.parse(3, message);
+    second.parse(3, message);
+    CHECK(second["message"] == "hello" && second["command"].empty());
+    CHECK(second["millis"].empty());
+
+    // entries are evicted beyond the capacity
+    cli::Commander small("dotfiles");
+    spec(small);
+    small.cache(1024);
+    char path[] = "0";
+    char *paths[] = {(char *)"dotfiles", (char *)"add", path};
+    for (char c = '0'; c <= '9'; c++) path[0] = c, small.parse(3, paths);
+    CHECK(small.stats().evictions > 0 && small.stats().bytes <= 1024);
+    small.parse(3, paths);
+    CHECK(small.stats().hits == 1 && small["paths"] == "9");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// -*- C++ -*-
+//===----------------------------- session.cpp ----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <sys/stat.h>
+#include <session.hpp>
+
+/**
+ *  Incremental parse of a line being typed: the completions of the commands,
+ *  the subcommands, the flags and the choices of the args, the errors of the
+ *  complete tokens only, and the cost of a keystroke, below 100us. A line of
+ *  the session naming an external command never replaces the process.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+using Candidates = std::vector<std::string>;
+
+int main()
+{
+    cli::Commander program("dotfiles", "manage dotfiles");
+    program.command("log <level> [path]", "show the log");
+    program.command("list", "list the tracked files");
+    program.command("remote", "manage the remotes", [](cli::Commander & c) {
+        c.command("add <name>", "add a remote");
+        c.command("remove <name>", "remove a remote");
+    });
+    program.option("-l, --lines <n>", "number of lines");
+    program.option("-f, --format <format>", "output format");
+    program.choices("level", {"debug", "info", "warn"});
+    program.choices("format", {"short", "long"});
+    program.range("n", -10, 10);
+
+    cli::Session session(program);
+
+    // commands, by their prefix
+    session.update("l");
+    CHECK(session.complete() == Candidates({"list", "log"}));
+    session.update("lo");
+    CHECK(session.complete() == Candidates({"log"}));
+    CHECK(session.update("lo").hint == "g");
+
+    // the choices of the first arg of a command
+    session.update("log ");
+    CHECK(session.complete() == Candidates({"debug", "info", "warn"}));
+    session.update("log w");
+    CHECK(session.complete() == Candidates({"warn"}));
+
+    // the subcommands of a command, then the args of the subcommand
+    session.update("remote ");
+    CHECK(session.complete() == Candidates({"add", "remove"}));
+    session.update("remote add ");
+    CHECK(session.complete().empty());
+    CHECK(session.update("remote add ").hint == " <name>");
+
+    // flags, and the choices of the args of an option
+    session.update("log info -");
+    CHECK(session.complete(2).size() == 2);
+    session.update("log info --f");
+    CHECK(session.complete() == Candidates({"--format"}));
+    session.update("log info --format ");
+    CHECK(session.complete() == Candidates({"short", "long"}));
+
+    // errors are reported once the token is complete
+    CHECK(session.update("log trace").error.empty());
+    CHECK(session.update("log trace ").error.size());
+    CHECK(session.update("lg").error.empty());
+    CHECK(session.update("lg ").fix == "Did you mean 'log'?");
+    CHECK(session.update("log info -l -5 ").error.empty());
+    CHECK(session.update("log info -l 50 ").error.size());
+
+    // an update only steps the tokens from the first that changed
+    session.update("log info --format s");
+    CHECK(session.words().size() == 4);
+    session.update("log info --format sh");
+    CHECK(session.complete() == Candidates({"short"}));
+    session.update("log debug --format sh");
+    CHECK(session.complete() == Candidates({"short"}));
+    CHECK(session.update("log debug --format short ").error.empty());
+    auto argv = session.argv();
+    program.parse(argv.size(), argv.data());
+    CHECK(program["level"] == "debug" && program["format"] == "short");
+
+    // a keystroke, an update and a completion, well below 100us: the median
+    // of many, a single one may be slowed by the machine
+    const std::string line = "log info --format long --lines 5 path";
+    using Clock = std::chrono::steady_clock;
+    std::vector<Clock::duration> spent;
+    for (int r = 0; r < 1000; r++)
+    {
+        const std::size_t n = r % line.size() + 1;
+        session.update(line.substr(0, n - 1));
+        const Clock::time_point start = Clock::now();
+        session.update(line.substr(0, n));
+        session.complete(16);
+        spent.push_back(Clock::now() - start);
+    }
+    std::nth_element(spent.begin(), spent.begin() + spent.size() / 2, 
+                     spent.end());
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        spent[spent.size() / 2]).count();
+    if (us >= 100) std::cerr << "keystroke in " << us << "us\n";
+    CHECK(us < 100);
+
+    // an external command on the PATH is not run from the session
+    char dir[] = "/tmp/cli-session-XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    const std::string hello = std::string(dir) + "/dotfiles-hello";
+    std::ofstream(hello) << "#!/bin/sh\nexit 3\n";
+    chmod(hello.c_str(), 0755);
+    setenv("PATH", dir, 1);
+    setenv("XDG_CACHE_HOME", dir, 1);
+    program.external();
+
+    session.update("hello ");
+    argv = session.argv();
+    bool refused = false;
+    try { program.parse(argv.size(), argv.data()); }
+    catch (const cli::Exception &) { refused = true; }
+    CHECK(refused);
+    std::filesystem::remove_all(dir);
+
+    return failures ? 1 : 0;
+}
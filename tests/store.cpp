@@ -0,0 +1,113 @@
+// -*- C++ -*-
+//===------------------------------ store.cpp -----------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <sys/stat.h>
+#include "activate.hpp"
+
+/**
+ *  Round trip of the files through the store. A large file is stored as its
+ *  chunks, a new version of it stores the chunks around the edit only, and
+ *  every version is checked out, or activated, byte for byte without the
+ *  whole file ever being kept in the objects.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+namespace fs = std::filesystem;
+
+static void write(const fs::path & path, const std::string & data)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+}
+
+static std::string read(const fs::path & path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+int main()
+{
+    char dir[] = "/tmp/dotfiles-test-XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    const fs::path home = fs::path(dir) / "home";
+    const fs::path root = home / ".dotfiles";
+
+    dotfiles::Store store(root, home);
+    dotfiles::Pool pool;
+    dotfiles::Report report;
+    store.init();
+
+    std::mt19937_64 rng(7);
+    std::string big(512 * 1024, '\0');
+    for (char & c : big) c = char(rng());
+    const std::string small = "set number\n";
+
+    write(home / "big", big);
+    write(home / "small", small);
+    report = store.add({(home / "big").string(), (home / "small").string()},
+                       pool);
+    CHECK(report.hashed == 2);
+    const std::string first = store.commit("first", pool, report);
+
+    // the large file is a recipe of chunks, the small one a whole object
+    const dotfiles::Tree tree = store.tree(first);
+    const dotfiles::Entry & entry = tree.at("big");
+    const std::string & hash = entry.hash;
+    CHECK(fs::exists(root / "recipes" / hash.substr(0, 2) / hash.substr(2)));
+    CHECK(!fs::exists(store.object(hash)));
+    CHECK(fs::exists(store.object(tree.at("small").hash)));
+
+    store.checkout(entry, fs::path(dir) / "big.1");
+    store.checkout(tree.at("small"), fs::path(dir) / "small.1");
+    CHECK(read(fs::path(dir) / "big.1") == big);
+    CHECK(read(fs::path(dir) / "small.1") == small);
+    CHECK(!fs::exists(store.object(hash)));
+
+    // an edit in the middle stores the chunks around it only
+    std::string edited = big;
+    edited.replace(200000, 5, "edit!");
+    write(home / "big", edited);
+    report = store.add({(home / "big").string()}, pool);
+    CHECK(report.hashed == 1);
+    CHECK(report.written > 0 && report.written < 128 * 1024);
+    const std::string second = store.commit("second", pool, report);
+
+    const dotfiles::Entry next = store.tree(second).at("big");
+    store.checkout(next, fs::path(dir) / "big.2");
+    CHECK(read(fs::path(dir) / "big.2") == edited);
+
+    // an activation writes the farm copy out of the chunks as well
+    dotfiles::Farm(store, pool).activate(second);
+    CHECK(fs::is_symlink(home / "big"));
+    CHECK(read(home / "big") == edited);
+    CHECK(!fs::exists(store.object(next.hash)));
+
+    fs::remove_all(dir);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+// -*- C++ -*-
+//===---------------------------- validator.cpp ---------------------------===//
+//
+//  Copyright (c) 2020 Manish sahani
+//
+//  This program is free software: Licensed under the MIT License. you may not
+//  use this file except in compliance with the License. You may obtain a copy
+//  of the License at http://www.apache.org/licenses/LICENSE-2.0
+//
+//===----------------------------------------------------------------------===//
+
+#include <string>
+#include <iostream>
+#include <commander.hpp>
+
+/**
+ *  Checks of the values in the parse: a range refuses what is not a number in
+ *  it, nan included, and a negative number is read as the value of the arg or
+ *  the option that wants one rather than as a flag. A streamed arg is checked
+ *  once, when the iteration reaches it.
+ */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+    if (!(cond))                                                               \
+    {                                                                          \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << #cond << "\n";     \
+        failures++;                                                            \
+    }
+
+template <std::size_t N>
+static bool refused(cli::Commander & program, const char *(&args)[N])
+{
+    try { program.parse(N, const_cast<char **>(args)); }
+    catch (const cli::Exception &) { return true; }
+    return false;
+}
+
+int main()
+{
+    cli::Commander program("dotfiles", "manage dotfiles");
+    program.command("move <offset>", "move the cursor");
+    program.option("-n, --lines <n>", "number of lines");
+    program.option("-b, --boom", "boom");
+    program.range("offset", -100, 100);
+    program.range("n", -10, 10);
+    program.choices("level", {"debug", "info", "warn", "error", "info"});
+    program.option("-l, --level <level>", "log level");
+
+    const char *negative[] = {"dotfiles", "move", "-3", "-n", "-5", "-b"};
+    CHECK(!refused(program, negative));
+    CHECK(program["command"] == "move");
+    CHECK(program["offset"] == "-3");
+    CHECK(program["n"] == "-5");
+
+    const char *decimal[] = {"dotfiles", "move", "1", "--lines", "-2.5"};
+    CHECK(!refused(program, decimal));
+    CHECK(program["n"] == "-2.5");
+
+    // a negative number is not taken by an option that wants no more values
+    const char *flag[] = {"dotfiles", "move", "1", "-b", "-5"};
+    CHECK(refused(program, flag));
+
+    const char *nan[] = {"dotfiles", "move", "1", "-n", "nan"};
+    CHECK(refused(program, nan));
+    const char *out[] = {"dotfiles", "move", "1", "-n", "-11"};
+    CHECK(refused(program, out));
+    const char *inf[] = {"dotfiles", "move", "-inf"};
+    CHECK(refused(program, inf));
+
+    const char *level[] = {"dotfiles", "move", "1", "-l", "warn"};
+    CHECK(!refused(program, level));
+    const char *unknown[] = {"dotfiles", "move", "1", "-l", "trace"};
+    CHECK(refused(program, unknown));
+
+    const char *streamed[] = {"dotfiles", "move", "-3"};
+    program.stream(3, const_cast<char **>(streamed));
+    CHECK(*program.positionals().begin() == "-3");
+
+    char *args[] = {(char *)"1", (char *)"2", (char *)"x"};
+    std::size_t checks = 0;
+    cli::Positionals positionals(args, args + 3, 
+                                 [&](std::size_t, std::string_view v) {
+        checks++;
+        if (!cli::helper::is_number(v)) throw cli::Exception("not a number");
+    });
+    auto itr = positionals.begin();
+    CHECK(*itr == "1" && *itr == "1" && checks == 1);
+    CHECK(*++itr == "2" && checks == 2);
+    bool thrown = false;
+    try { ++itr; }
+    catch (const cli::Exception &) { thrown = true; }
+    CHECK(thrown && checks == 3);
+
+    // a set of many choices, every one found and nothing else
+    std::vector<std::string> many;
+    for (int i = 0; i < 1000; i++) many.push_back("choice" + std::to_string(i));
+    cli::Choices choices(many);
+    for (auto & c : many) CHECK(choices.contains(c));
+    CHECK(!choices.contains("choice1000") && !choices.contains(""));
+
+    return failures ? 1 : 0;
+}